@@ -28,6 +28,7 @@
 #include <format>
 #include <map>
 #include <sddl.h>
+#include <shared_mutex>
 #include <string>
 
 BOOL ShellExecuteThrow(HWND hwnd, const std::wstring & lpVerb, const std::wstring & lpFile,
@@ -105,19 +106,20 @@ std::wstring GetNameFromSid(const PSID sid)
         return memcmp(p1, p2, l1) > 0;
     };
 
-    // attempt to lookup sid in cache
+    // attempt to lookup sid in cache; the cache is shared by all threads
+    static std::shared_mutex nameLock;
     static std::map<PSID, std::wstring, decltype(comp)> nameMap(comp);
-    const auto iter = nameMap.find(sid);
-    if (iter != nameMap.end())
     {
-        return iter->second;
+        std::shared_lock lock(nameLock);
+        const auto iter = nameMap.find(sid);
+        if (iter != nameMap.end())
+        {
+            return iter->second;
+        }
     }
 
-    // copy the sid for storage in our cache table
-    const DWORD sidLength = SidGetLength(sid);
-    const auto sidCopy = memcpy(malloc(sidLength), sid, sidLength);
-
-    // lookup the name for this sid
+    // lookup the name for this sid outside of the lock as this can be slow
+    std::wstring name;
     SID_NAME_USE nameUse;
     WCHAR accountName[UNLEN + 1], domainName[UNLEN + 1];
     DWORD iAccountNameSize = _countof(accountName), iDomainName = _countof(domainName);
@@ -126,14 +128,22 @@ std::wstring GetNameFromSid(const PSID sid)
     {
         SmartPointer<LPWSTR> sidBuff(LocalFree);
         ConvertSidToStringSid(sid, &sidBuff);
-        nameMap[sidCopy] = sidBuff;
+        name = sidBuff;
     }
     else
     {
         // generate full name in domain\name format
-        nameMap[sidCopy] = std::format(L"{}\\{}", domainName, accountName);
+        name = std::format(L"{}\\{}", domainName, accountName);
+    }
+
+    // copy the sid for storage in our cache table unless another thread was faster
+    std::unique_lock lock(nameLock);
+    if (!nameMap.contains(sid))
+    {
+        const DWORD sidLength = SidGetLength(sid);
+        nameMap.emplace(memcpy(malloc(sidLength), sid, sidLength), name);
     }
 
     // return name
-    return nameMap[sidCopy];
+    return name;
 }
@@ -0,0 +1,239 @@
+// Benchmarks.cpp
+//
+// WinDirStat - Directory Statistics
+// Copyright (C) 2024 WinDirStat Team (windirstat.net)
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#include "stdafx.h"
+#include "Benchmarks.h"
+#include "GlobalHelpers.h"
+#include "Item.h"
+#include "SmartPointer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Sorts a folder of synthetic files by each column of the file tree, both by
+    // comparing the items and by their sort keys. The files are visible like rows
+    // and their owners are resolved beforehand, so neither way reads them from disk.
+    int RunSortBenchmark(const int children, const int iterations)
+    {
+        using Clock = std::chrono::steady_clock;
+        const auto milliseconds = [](const Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+        const auto root = std::make_unique<CItem>(IT_DIRECTORY, L"Benchmark");
+        std::mt19937_64 random(0);
+        for (int i = 0; i < children; i++)
+        {
+            const ULONGLONG size = random() % (1ull << 32);
+            const ULONGLONG time = random();
+            const DWORD attributes = static_cast<DWORD>(random()) & (FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN |
+                FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_ARCHIVE | FILE_ATTRIBUTE_COMPRESSED | FILE_ATTRIBUTE_ENCRYPTED);
+            root->AddChild(new CItem(IT_FILE, std::format(L"File{:016X}.dat", random()),
+                FILETIME{ static_cast<DWORD>(time), static_cast<DWORD>(time >> 32) }, size, size, attributes, 0, 0), true);
+        }
+        root->SetVisible(nullptr, true);
+        for (const auto& child : root->GetChildren())
+        {
+            child->SetVisible(nullptr, true);
+            child->SetResolvedOwner(std::format(L"User{}", random() % 16));
+        }
+
+        for (const auto& [column, name] : { std::pair(COL_NAME, L"Name"), std::pair(COL_SUBTREEPERCENTAGE, L"Subtree Percentage"),
+            std::pair(COL_PERCENTAGE, L"Percentage"), std::pair(COL_SIZE_PHYSICAL, L"Size (Physical)"),
+            std::pair(COL_SIZE_LOGICAL, L"Size (Logical)"), std::pair(COL_ITEMS, L"Items"), std::pair(COL_FILES, L"Files"),
+            std::pair(COL_FOLDERS, L"Folders"), std::pair(COL_LASTCHANGE, L"Last Change"),
+            std::pair(COL_ATTRIBUTES, L"Attributes"), std::pair(COL_OWNER, L"Owner") })
+        {
+            SSorting sorting;
+            sorting.subitem1 = column;
+            sorting.subitem2 = column;
+
+            Clock::duration compared{};
+            Clock::duration keyed{};
+            for (int i = 0; i < iterations; i++)
+            {
+                std::vector<CTreeListItem*> items(root->GetChildren().begin(), root->GetChildren().end());
+                const auto start = Clock::now();
+                std::ranges::sort(items, [&sorting](const CTreeListItem* item1, const CTreeListItem* item2)
+                {
+                    return item1->CompareString(item2, sorting) < 0;
+                });
+                const auto middle = Clock::now();
+                root->SortChildren(sorting);
+                compared += middle - start;
+                keyed += Clock::now() - middle;
+            }
+
+            const double comparedTime = milliseconds(compared) / iterations;
+            const double keyedTime = milliseconds(keyed) / iterations;
+            WriteCommandOutput(std::format(L"{}: {} children, {:.1f} ms by comparison, {:.1f} ms by sort keys ({:.2f}x)\n",
+                name, children, comparedTime, keyedTime, comparedTime / max(keyedTime, 0.001)));
+        }
+
+        CItem::ResetOwners();
+        return 0;
+    }
+
+    // Measures the progress reporting per entry read by a scanning thread in the
+    // deepest folder of a chain of visible folders that are being scanned: the
+    // former walk over all ancestors against counting a step for the UI to sample
+    int RunProgressBenchmark(const int depth, const int files)
+    {
+        using Clock = std::chrono::steady_clock;
+        const auto nanoseconds = [](const Clock::duration d) { return std::chrono::duration<double, std::nano>(d).count(); };
+
+        const auto root = std::make_unique<CItem>(IT_DIRECTORY, L"Benchmark");
+        std::vector<CItem*> chain = { root.get() };
+        for (int i = 1; i < depth; i++)
+        {
+            chain.push_back(new CItem(IT_DIRECTORY, std::format(L"Folder{}", i)));
+            chain[i - 1]->AddChild(chain[i], true);
+        }
+        chain.back()->UpwardAddReadJobs(1);
+        for (const auto& folder : chain) folder->SetVisible(nullptr, true);
+
+        auto start = Clock::now();
+        for (int i = 0; i < files; i++)
+        {
+            for (auto p = chain.back(); p != nullptr; p = p->GetParent())
+            {
+                if (p->IsType(IT_FILE) || !p->IsVisible()) continue;
+                if (p->GetReadJobs() == 0) p->StopPacman();
+                else p->DrivePacman();
+            }
+        }
+        const double before = nanoseconds(Clock::now() - start) / files;
+
+        start = Clock::now();
+        CItem::PublishScanItem(chain.back());
+        for (int i = 0; i < files; i++)
+        {
+            CItem::PublishScanStep();
+        }
+        const double after = nanoseconds(Clock::now() - start) / files;
+
+        start = Clock::now();
+        CItem::SampleScanProgress();
+        const double sample = nanoseconds(Clock::now() - start);
+        CItem::PublishScanItem(nullptr);
+
+        WriteCommandOutput(std::format(L"{} levels, {} files: {:.1f} ns per file walking the ancestors, "
+            L"{:.1f} ns per file counting steps ({:.1f}x), {:.1f} us per sample\n",
+            depth, files, before, after, before / max(after, 0.001), sample / 1000.0));
+
+        return 0;
+    }
+
+    // Reads a file in blocks of the size GetFileHash() uses, one after the
+    // other, and hashes each block before the next is read if hash is set
+    bool ReadSequentially(const std::wstring& path, const bool hash)
+    {
+        SmartPointer<HANDLE> hFile(CloseHandle, CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+            nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+        if (hFile == INVALID_HANDLE_VALUE || (hash && !InitializeHashing())) return false;
+
+        std::vector<BYTE> buffer(1024ull * 1024ull);
+        DWORD read = 0;
+        while (ReadFile(hFile, buffer.data(), static_cast<DWORD>(buffer.size()), &read, nullptr) != 0 && read > 0)
+        {
+            if (hash) UpdateHashing(buffer.data(), read);
+        }
+        if (hash) FinishHashing();
+        return true;
+    }
+
+    // Compares the throughput of GetFileHash(), which reads ahead while hashing,
+    // with reading and hashing in turn and with reading alone, which bounds it.
+    // Each iteration runs all three, so they see the same caching; files larger
+    // than the memory or on a device without cache give the device figures.
+    int RunHashBenchmark(const std::wstring& path, const int iterations)
+    {
+        using Clock = std::chrono::steady_clock;
+        const auto seconds = [](const Clock::duration d) { return std::chrono::duration<double>(d).count(); };
+
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        const std::size_t separator = path.find_last_of(L"\\/");
+        if (separator == std::wstring::npos || !GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &data) ||
+            (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+        {
+            WriteCommandOutput(std::format(L"Cannot open {}\n", path));
+            return 1;
+        }
+
+        const ULONGLONG size = static_cast<ULONGLONG>(data.nFileSizeHigh) << 32 | data.nFileSizeLow;
+        const auto folder = std::make_unique<CItem>(IT_DIRECTORY, path.substr(0, separator));
+        const auto file = new CItem(IT_FILE, path.substr(separator + 1), data.ftLastWriteTime, size, size, data.dwFileAttributes, 0, 0);
+        folder->AddChild(file, true);
+        BlockingQueue<CItem*> queue;
+
+        Clock::duration overlapped{};
+        Clock::duration sequential{};
+        Clock::duration reading{};
+        for (int i = 0; i < iterations; i++)
+        {
+            auto start = Clock::now();
+            if (file->GetFileHash(0, &queue).empty())
+            {
+                WriteCommandOutput(std::format(L"Cannot hash {}\n", path));
+                return 1;
+            }
+            overlapped += Clock::now() - start;
+
+            start = Clock::now();
+            ReadSequentially(file->GetPathLong(), true);
+            sequential += Clock::now() - start;
+
+            start = Clock::now();
+            ReadSequentially(file->GetPathLong(), false);
+            reading += Clock::now() - start;
+        }
+
+        const double megabytes = static_cast<double>(size) * iterations / (1024.0 * 1024.0);
+        WriteCommandOutput(std::format(L"{} MiB: {:.0f} MiB/s reading ahead while hashing, {:.0f} MiB/s reading and hashing in turn, "
+            L"{:.0f} MiB/s reading only\n", size / (1024ull * 1024ull), megabytes / max(seconds(overlapped), 1e-9),
+            megabytes / max(seconds(sequential), 1e-9), megabytes / max(seconds(reading), 1e-9)));
+
+        return 0;
+    }
+}
+
+int RunBenchmarkCommand(const std::vector<std::wstring>& args)
+{
+    if (args.size() >= 2 && _wcsicmp(args[1].c_str(), L"/sortbench") == 0)
+    {
+        return RunSortBenchmark(ParseCommandInt(args, 2, 1000000), ParseCommandInt(args, 3, 3));
+    }
+
+    if (args.size() >= 2 && _wcsicmp(args[1].c_str(), L"/progressbench") == 0)
+    {
+        return RunProgressBenchmark(ParseCommandInt(args, 2, 32), ParseCommandInt(args, 3, 1000000));
+    }
+
+    if (args.size() >= 3 && _wcsicmp(args[1].c_str(), L"/hashbench") == 0)
+    {
+        return RunHashBenchmark(args[2], ParseCommandInt(args, 3, 3));
+    }
+
+    return -1;
+}
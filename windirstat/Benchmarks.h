@@ -0,0 +1,34 @@
+// Benchmarks.h
+//
+// WinDirStat - Directory Statistics
+// Copyright (C) 2024 WinDirStat Team (windirstat.net)
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Handles the command lines
+//   windirstat.exe /sortbench [children] [iterations]
+//   windirstat.exe /progressbench [depth] [files]
+//   windirstat.exe /hashbench <file> [iterations]
+// which benchmark the sorting of the file tree or the progress reporting of
+// the scan on synthetic items, or the hashing of a file for the duplicate
+// detection, without showing a window.
+// Returns the process exit code or -1 if the command line is not one of these.
+int RunBenchmarkCommand(const std::vector<std::wstring>& args);
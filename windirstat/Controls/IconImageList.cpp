@@ -156,6 +156,57 @@ std::wstring CIconImageList::GetADriveSpec()
     return s.substr(0, 3);
 }
 
+// Returns the image resolved for the key or -1 while it is being resolved;
+// the most recent requests (the rows on screen) are resolved first
+short CIconImageList::GetResolvedImage(const std::wstring& key, const std::function<short()>& resolve)
+{
+    std::lock_guard lock(m_ResolveMutex);
+    if (const auto resolved = m_Resolved.find(key); resolved != m_Resolved.end())
+    {
+        return resolved->second;
+    }
+
+    while (m_ResolveThreads.size() < RESOLVER_THREADS)
+    {
+        m_ResolveThreads.emplace_back([this](const std::stop_token& stop) { ResolveImages(stop); });
+    }
+
+    m_Resolved[key] = -1;
+    m_ResolveQueue.emplace_front(key, resolve);
+    m_ResolveRequested.notify_one();
+    return -1;
+}
+
+// Returns whether images were resolved since the last call
+bool CIconImageList::HaveImagesResolved()
+{
+    return m_ResolvedChanged.exchange(false);
+}
+
+void CIconImageList::ResolveImages(const std::stop_token& stop)
+{
+    // The shell requires COM on every thread that asks it for images
+    (void) ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
+
+    while (true)
+    {
+        std::pair<std::wstring, std::function<short()>> request;
+        {
+            std::unique_lock lock(m_ResolveMutex);
+            if (!m_ResolveRequested.wait(lock, stop, [this] { return !m_ResolveQueue.empty(); })) break;
+            request = std::move(m_ResolveQueue.front());
+            m_ResolveQueue.pop_front();
+        }
+
+        const short image = request.second();
+        std::lock_guard lock(m_ResolveMutex);
+        m_Resolved[request.first] = image;
+        m_ResolvedChanged = true;
+    }
+
+    ::CoUninitialize();
+}
+
 void CIconImageList::AddCustomImages()
 {
     m_JunctionImage = static_cast<short>(this->Add(CDirStatApp::Get()->LoadIcon(IDI_JUNCTION)));
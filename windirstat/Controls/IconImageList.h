@@ -21,9 +21,16 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <shared_mutex>
+#include <vector>
 
 //
 // CIconImageList. Both CFileTreeView and CExtensionView use this central
@@ -31,6 +38,9 @@
 // and adds a few special images at initialization.
 // This is because I don't want to deal with two images lists.
 //
+// Images which need the shell or the file system can be resolved by a few
+// background threads instead, so that painting never waits for them.
+//
 class CIconImageList final : public CImageList
 {
     static constexpr UINT WDS_SHGFI_DEFAULTS = SHGFI_USEFILEATTRIBUTES | SHGFI_SYSICONINDEX | SHGFI_SMALLICON | SHGFI_ICON;
@@ -57,6 +67,9 @@ public:
     static std::wstring GetADriveSpec();
     void AddCustomImages();
 
+    short GetResolvedImage(const std::wstring& key, const std::function<short()>& resolve);
+    bool HaveImagesResolved();
+
     std::shared_mutex m_IndexMutex;
     std::unordered_map<int, short> m_IndexMap; // system image list index -> our index
 
@@ -65,4 +78,15 @@ public:
     short m_EmptyImage = -1;        // For items whose image cannot be found
     short m_JunctionImage = -1;     // For normal functions
     short m_JunctionProtected = -1; // For protected junctions
+
+private:
+    void ResolveImages(const std::stop_token& stop);
+
+    static constexpr auto RESOLVER_THREADS = 2;
+    std::mutex m_ResolveMutex;
+    std::condition_variable_any m_ResolveRequested;
+    std::deque<std::pair<std::wstring, std::function<short()>>> m_ResolveQueue;
+    std::unordered_map<std::wstring, short> m_Resolved; // key -> our index, -1 while pending
+    std::atomic<bool> m_ResolvedChanged = false;
+    std::vector<std::jthread> m_ResolveThreads;
 };
@@ -353,7 +353,7 @@ int COwnerDrawnListControl::GetGeneralLeftIndent() const
 
 COwnerDrawnListItem* COwnerDrawnListControl::GetItem(const int i) const
 {
-    const auto item = reinterpret_cast<COwnerDrawnListItem*>(GetItemData(i));
+    const auto item = static_cast<COwnerDrawnListItem*>(GetSortingListItem(i));
     return item;
 }
 
@@ -395,7 +395,7 @@ void COwnerDrawnListControl::InitializeColors()
 
 void COwnerDrawnListControl::DrawItem(LPDRAWITEMSTRUCT pdis)
 {
-    const COwnerDrawnListItem* item = reinterpret_cast<COwnerDrawnListItem*>(pdis->itemData);
+    const COwnerDrawnListItem* item = GetItem(static_cast<int>(pdis->itemID));
     CDC* pdc = CDC::FromHandle(pdis->hDC);
     CRect rcItem(pdis->rcItem);
 
@@ -98,7 +98,7 @@ public:
     COLORREF GetItemSelectionTextColor(int i) const;
 
     COwnerDrawnListItem* GetItem(int i) const;
-    int FindListItem(const COwnerDrawnListItem* item) const;
+    virtual int FindListItem(const COwnerDrawnListItem* item) const;
     int GetTextXMargin() const;
     int GetGeneralLeftIndent() const;
     CRect GetWholeSubitemRect(int item, int subitem) const;
@@ -179,6 +179,12 @@ void CSortingListControl::SortItems()
         const SSorting* sorting = reinterpret_cast<SSorting*>(lParamSort);
         return item1->CompareString(item2, *sorting); }, reinterpret_cast<DWORD_PTR>(&m_Sorting)));
 
+    IndicateSorting();
+}
+
+// Indicates the sort column and -order by a "<" or ">" in the header
+void CSortingListControl::IndicateSorting()
+{
     if (m_IndicatedColumn != -1)
     {
         HDITEM hditem;
@@ -233,7 +239,10 @@ void CSortingListControl::OnLvnGetDispInfo(NMHDR* pNMHDR, LRESULT* pResult)
     NMLVDISPINFO* displayInfo = reinterpret_cast<NMLVDISPINFO*>(pNMHDR);
     *pResult = FALSE;
 
-    const CSortingListItem* item = reinterpret_cast<CSortingListItem*>(displayInfo->item.lParam);
+    // Virtual lists don't store the lParam of their items
+    const CSortingListItem* item = (GetStyle() & LVS_OWNERDATA) != 0 ?
+        GetSortingListItem(displayInfo->item.iItem) :
+        reinterpret_cast<CSortingListItem*>(displayInfo->item.lParam);
 
     if ((displayInfo->item.mask & LVIF_TEXT) != 0)
     {
@@ -83,13 +83,16 @@ class CSortingListControl : public CListCtrl
     void SetSorting(int sortColumn, bool ascending);
 
     void InsertListItem(int i, CSortingListItem* item);
-    CSortingListItem* GetSortingListItem(int i) const;
+    virtual CSortingListItem* GetSortingListItem(int i) const;
 
     // Overridables
     virtual void SortItems();
     virtual bool GetAscendingDefault(int column);
     virtual bool HasImages();
 
+protected:
+    void IndicateSorting();
+
 private:
     void SavePersistentAttributes() const;
  
@@ -26,7 +26,9 @@
 #include "TreeListControl.h"
 
 #include <algorithm>
+#include <execution>
 #include <ranges>
+#include <unordered_map>
 
 namespace
 {
@@ -49,6 +51,21 @@ namespace
     constexpr auto HOTNODE_CX = 9; // Size and position of the +/- buttons
     constexpr auto HOTNODE_CY = 9;
     constexpr auto HOTNODE_X = 0;
+
+    constexpr auto PARALLEL_SORT_MINIMUM = 10000; // Children from which on they are sorted in parallel
+}
+
+CTreeListItem::SORTKEY CTreeListItem::SORTKEY::FromText(std::wstring text)
+{
+    // Like _wcsicmp(), which compares the lower case texts
+    _wcslwr_s(text.data(), text.size() + 1);
+    return { 0, std::move(text) };
+}
+
+int CTreeListItem::SORTKEY::Compare(const SORTKEY& other) const
+{
+    const int r = usignum(number, other.number);
+    return r != 0 ? r : signum(text.compare(other.text));
 }
 
 CTreeListItem::~CTreeListItem()
@@ -94,7 +111,10 @@ int CTreeListItem::GetImage() const
     ASSERT(IsVisible());
     if (m_VisualInfo->image == -1)
     {
-        m_VisualInfo->image = GetImageToCache();
+        // Images still being resolved are shown empty and asked for again
+        const short image = GetImageToCache();
+        if (image == -1) return GetIconImageList()->GetEmptyImage();
+        m_VisualInfo->image = image;
     }
     return m_VisualInfo->image;
 }
@@ -155,18 +175,52 @@ void CTreeListItem::SortChildren(const SSorting& sorting)
         return;
     }
 
+    // Extract the sort keys once per child instead of twice per comparison
+    struct SORTENTRY
+    {
+        SORTKEY key1;
+        SORTKEY key2;
+        CTreeListItem* child;
+    };
+
     const int children = GetTreeListChildCount();
-    m_VisualInfo->sortedChildren.resize(children, nullptr);
+    std::vector<SORTENTRY> entries(children);
     for (int i = 0; i < children; i++)
     {
-        m_VisualInfo->sortedChildren[i] = GetTreeListChild(i);
+        entries[i].child = GetTreeListChild(i);
     }
 
-    // sort by size for proper treemap rendering
-    std::ranges::sort(m_VisualInfo->sortedChildren, [sorting](auto item1, auto item2)
+    const bool secondary = sorting.subitem1 != sorting.subitem2;
+    const auto extract = [&sorting, secondary](SORTENTRY& entry)
+    {
+        entry.key1 = entry.child->GetSortKey(sorting.subitem1);
+        if (secondary) entry.key2 = entry.child->GetSortKey(sorting.subitem2);
+    };
+    const auto compare = [&sorting, secondary](const SORTENTRY& entry1, const SORTENTRY& entry2)
+    {
+        int r = entry1.key1.Compare(entry2.key1);
+        if (!sorting.ascending1) r = -r;
+        if (r == 0 && secondary)
         {
-            return item1->CompareString(item2, sorting) < 0;
-        });
+            r = entry1.key2.Compare(entry2.key2);
+            if (!sorting.ascending2) r = -r;
+        }
+        return r < 0;
+    };
+
+    if (children >= PARALLEL_SORT_MINIMUM)
+    {
+        std::for_each(std::execution::par, entries.begin(), entries.end(), extract);
+        std::sort(std::execution::par, entries.begin(), entries.end(), compare);
+    }
+    else
+    {
+        std::ranges::for_each(entries, extract);
+        std::ranges::sort(entries, compare);
+    }
+
+    m_VisualInfo->sortedChildren.resize(children, nullptr);
+    std::ranges::transform(entries, m_VisualInfo->sortedChildren.begin(), &SORTENTRY::child);
 }
 
 CTreeListItem* CTreeListItem::GetSortedChild(const int i) const
@@ -174,6 +228,12 @@ CTreeListItem* CTreeListItem::GetSortedChild(const int i) const
     return m_VisualInfo->sortedChildren[i];
 }
 
+// Children added by other threads are only counted once sorted again
+int CTreeListItem::GetSortedChildCount() const
+{
+    return static_cast<int>(m_VisualInfo->sortedChildren.size());
+}
+
 int CTreeListItem::Compare(const CSortingListItem* baseOther, const int subitem) const
 {
     const auto other = reinterpret_cast<const CTreeListItem*>(baseOther);
@@ -213,7 +273,7 @@ int CTreeListItem::Compare(const CSortingListItem* baseOther, const int subitem)
 
 int CTreeListItem::FindSortedChild(const CTreeListItem* child) const
 {
-    for (int i = 0; i < GetTreeListChildCount(); i++)
+    for (int i = 0; i < GetSortedChildCount(); i++)
     {
         if (child == GetSortedChild(i))
         {
@@ -252,8 +312,8 @@ bool CTreeListItem::HasSiblings() const
     {
         return false;
     }
-    const int i = m_Parent->FindSortedChild(this);
-    return i < m_Parent->GetTreeListChildCount() - 1;
+    const int count = m_Parent->GetSortedChildCount();
+    return count > 0 && m_Parent->GetSortedChild(count - 1) != this;
 }
 
 bool CTreeListItem::HasChildren() const
@@ -261,10 +321,10 @@ bool CTreeListItem::HasChildren() const
     return GetTreeListChildCount() > 0;
 }
 
+// Expanded items always have their visual state
 bool CTreeListItem::IsExpanded() const
 {
-    ASSERT(IsVisible());
-    return m_VisualInfo->isExpanded;
+    return IsVisible() && m_VisualInfo->isExpanded;
 }
 
 void CTreeListItem::SetExpanded(const bool expanded)
@@ -303,8 +363,7 @@ void CTreeListItem::SetIndent(const unsigned char indent)
 
 CRect CTreeListItem::GetPlusMinusRect() const
 {
-    ASSERT(IsVisible());
-    return m_VisualInfo->rcPlusMinus;
+    return IsVisible() ? m_VisualInfo->rcPlusMinus : CRect();
 }
 
 void CTreeListItem::SetPlusMinusRect(const CRect& rc) const
@@ -315,8 +374,7 @@ void CTreeListItem::SetPlusMinusRect(const CRect& rc) const
 
 CRect CTreeListItem::GetTitleRect() const
 {
-    ASSERT(IsVisible());
-    return m_VisualInfo->rcTitle;
+    return IsVisible() ? m_VisualInfo->rcTitle : CRect();
 }
 
 void CTreeListItem::SetTitleRect(const CRect& rc) const
@@ -351,7 +409,7 @@ BOOL CTreeListControl::CreateEx(const DWORD dwExStyle, DWORD dwStyle, const RECT
 {
     InitializeNodeBitmaps();
 
-    dwStyle |= LVS_OWNERDRAWFIXED;
+    dwStyle |= LVS_OWNERDRAWFIXED | LVS_OWNERDATA;
 
     const BOOL bRet = Create(dwStyle, rect, pParentWnd, nID);
     VERIFY(bRet);
@@ -370,7 +428,35 @@ void CTreeListControl::SysColorChanged()
 
 CTreeListItem* CTreeListControl::GetItem(const int i) const
 {
-    return reinterpret_cast<CTreeListItem*>(GetItemData(i));
+    if (i < 0 || i >= static_cast<int>(m_Rows.size()))
+    {
+        return nullptr;
+    }
+    return m_Rows[i].item;
+}
+
+// The list view asks for the rows on screen only, so
+// the visual state of their items is created here
+CTreeListItem* CTreeListControl::GetVisibleItem(const int i) const
+{
+    CTreeListItem* item = GetItem(i);
+    if (item != nullptr && !item->IsVisible())
+    {
+        item->SetVisible(const_cast<CTreeListControl*>(this), true);
+        item->SetIndent(m_Rows[i].indent);
+    }
+    return item;
+}
+
+CSortingListItem* CTreeListControl::GetSortingListItem(const int i) const
+{
+    return GetVisibleItem(i);
+}
+
+int CTreeListControl::FindListItem(const COwnerDrawnListItem* item) const
+{
+    const auto row = std::ranges::find(m_Rows, item, &ROW::item);
+    return row == m_Rows.end() ? -1 : static_cast<int>(row - m_Rows.begin());
 }
 
 bool CTreeListControl::IsItemSelected(const CTreeListItem* item) const
@@ -393,11 +479,12 @@ void CTreeListControl::SelectItem(const CTreeListItem* item, const bool deselect
 
 void CTreeListControl::SetRootItem(CTreeListItem* root)
 {
+    m_Rows.clear();
     DeleteAllItems();
 
     if (root != nullptr)
     {
-        InsertItem(0, root);
+        InsertItem(0, root, 0);
         ExpandItem(0);
     }
 }
@@ -446,7 +533,7 @@ void CTreeListControl::ExpandPathToItem(const CTreeListItem* item)
         parent = index;
     }
 
-    const int w = GetSubItemWidth(GetItem(FindTreeItem(paths[0])), 0) + 5;
+    const int w = GetSubItemWidth(GetVisibleItem(FindTreeItem(paths[0])), 0) + 5;
     if (GetColumnWidth(0) < w)
     {
         SetColumnWidth(0, w);
@@ -471,17 +558,93 @@ void CTreeListControl::InitializeNodeBitmaps()
     VERIFY(m_BmNodes1.LoadMappedBitmap(IDB_NODES, 0, cm, 1));
 }
 
-void CTreeListControl::InsertItem(const int i, CTreeListItem* item)
+void CTreeListControl::InsertItem(const int i, CTreeListItem* item, const unsigned char indent)
+{
+    InsertItems(i, { item }, indent);
+}
+
+// Only the tree state goes into the rows; the visual
+// state is created once the rows come on screen
+void CTreeListControl::InsertItems(const int i, const std::vector<CTreeListItem*>& items, const unsigned char indent)
 {
-    InsertListItem(i, item);
-    item->SetVisible(this, true);
+    SELECTION selection = SaveSelection(i);
+
+    const int count = static_cast<int>(items.size());
+    m_Rows.insert(m_Rows.begin() + i, items.size(), { nullptr, indent, false });
+    for (int k = 0; k < count; k++)
+    {
+        m_Rows[i + k].item = items[k];
+    }
+    SetItemCountEx(static_cast<int>(m_Rows.size()), LVSICF_NOSCROLL);
+
+    selection.Move([count](const int k) { return k + count; });
+    RestoreSelection(selection);
 }
 
 void CTreeListControl::DeleteItem(const int i)
 {
-    GetItem(i)->SetExpanded(false);
-    GetItem(i)->SetVisible(this, false);
-    COwnerDrawnListControl::DeleteItem(i);
+    DeleteItems(i, 1);
+}
+
+void CTreeListControl::DeleteItems(const int i, const int count)
+{
+    SELECTION selection = SaveSelection(i);
+
+    for (int k = i; k < i + count; k++)
+    {
+        CTreeListItem* item = m_Rows[k].item;
+        if (!item->IsVisible()) continue;
+        item->SetExpanded(false);
+        item->SetVisible(this, false);
+    }
+    m_Rows.erase(m_Rows.begin() + i, m_Rows.begin() + i + count);
+    SetItemCountEx(static_cast<int>(m_Rows.size()), LVSICF_NOSCROLL);
+
+    selection.Move([i, count](const int k) { return k < i + count ? -1 : k - count; });
+    RestoreSelection(selection);
+}
+
+// The list view keeps the selection by row index and does not know that
+// rows are moved, so the selection of the rows from first on is taken
+// off here and restored on the rows that they have been moved to
+CTreeListControl::SELECTION CTreeListControl::SaveSelection(const int first)
+{
+    SELECTION selection;
+    for (int i = GetNextItem(first - 1, LVNI_SELECTED); i != -1; i = GetNextItem(i, LVNI_SELECTED))
+    {
+        selection.selected.push_back(i);
+    }
+    if (const int focused = GetNextItem(-1, LVNI_FOCUSED); focused >= first) selection.focused = focused;
+    if (const int mark = GetSelectionMark(); mark >= first) selection.mark = mark;
+
+    m_UpdatingSelection = true;
+    for (const int i : selection.selected)
+    {
+        SetItemState(i, 0, LVIS_SELECTED);
+    }
+    if (selection.focused != -1) SetItemState(selection.focused, 0, LVIS_FOCUSED);
+    if (selection.mark != -1) SetSelectionMark(-1);
+    m_UpdatingSelection = false;
+    return selection;
+}
+
+void CTreeListControl::RestoreSelection(const SELECTION& selection)
+{
+    m_UpdatingSelection = true;
+    for (const int i : selection.selected)
+    {
+        if (i != -1) SetItemState(i, LVIS_SELECTED, LVIS_SELECTED);
+    }
+    if (selection.focused != -1) SetItemState(selection.focused, LVIS_FOCUSED, LVIS_FOCUSED);
+    if (selection.mark != -1) SetSelectionMark(selection.mark);
+    m_UpdatingSelection = false;
+}
+
+// The row keeps the expansion for the layout, the item for its drawing
+void CTreeListControl::SetRowExpanded(const int i, const bool expanded)
+{
+    m_Rows[i].expanded = expanded;
+    GetVisibleItem(i)->SetExpanded(expanded);
 }
 
 int CTreeListControl::FindTreeItem(const CTreeListItem* item) const
@@ -494,6 +657,9 @@ int CTreeListControl::FindTreeItem(const CTreeListItem* item) const
 BEGIN_MESSAGE_MAP(CTreeListControl, COwnerDrawnListControl)
     ON_WM_MEASUREITEM_REFLECT()
     ON_NOTIFY_REFLECT(LVN_ITEMCHANGING, OnLvnItemchangingList)
+    ON_NOTIFY_REFLECT_EX(LVN_ITEMCHANGED, OnLvnItemchangedList)
+    ON_NOTIFY_REFLECT_EX(LVN_ODSTATECHANGED, OnLvnOdstatechangedList)
+    ON_NOTIFY_REFLECT(LVN_ODFINDITEM, OnLvnOdfinditemList)
     ON_WM_LBUTTONDOWN()
     ON_WM_KEYDOWN()
     ON_WM_LBUTTONDBLCLK()
@@ -664,7 +830,7 @@ void CTreeListControl::EmulateInteractiveSelection(const CTreeListItem* item)
 
 void CTreeListControl::ToggleExpansion(const int i)
 {
-    if (GetItem(i)->IsExpanded())
+    if (m_Rows[i].expanded)
     {
         CollapseItem(i);
     }
@@ -676,33 +842,26 @@ void CTreeListControl::ToggleExpansion(const int i)
 
 void CTreeListControl::CollapseItem(const int i)
 {
-    CTreeListItem* item = GetItem(i);
-    if (!item->IsExpanded())
+    if (!m_Rows[i].expanded)
     {
         return;
     }
 
     CWaitCursor wc;
-    LockWindowUpdate();
 
     int todelete = 0;
-    for (int k = i + 1; k < GetItemCount(); k++)
+    for (int k = i + 1; k < static_cast<int>(m_Rows.size()); k++)
     {
-        const CTreeListItem* child = GetItem(k);
-        if (child->GetIndent() <= item->GetIndent())
+        if (m_Rows[k].indent <= m_Rows[i].indent)
         {
             break;
         }
         todelete++;
     }
 
-    for (int m = i + todelete; m > i; m--)
-    {
-        DeleteItem(m);
-    }
-    item->SetExpanded(false);
+    DeleteItems(i + 1, todelete);
+    SetRowExpanded(i, false);
 
-    UnlockWindowUpdate();
     RedrawItems(i, i);
 }
 
@@ -746,46 +905,48 @@ void CTreeListControl::ExpandItem(const CTreeListItem* item)
 
 void CTreeListControl::ExpandItem(const int i, const bool scroll)
 {
-    CTreeListItem* item = GetItem(i);
-    if (item->IsExpanded())
+    if (m_Rows[i].expanded)
     {
         return;
     }
 
     CWaitCursor wc;
 
+    // Expanded before the children are sorted, so that
+    // children added meanwhile by other threads are posted
+    SetRowExpanded(i, true);
+    CTreeListItem* item = GetItem(i);
     item->SortChildren(GetSorting());
 
-    LockWindowUpdate();
-    int maxwidth = GetSubItemWidth(item, 0);
-    for (int c = 0; c < item->GetTreeListChildCount(); c++)
+    // The children are inserted as a whole, the list view only learns the new row count
+    std::vector<CTreeListItem*> children(item->GetSortedChildCount());
+    for (int c = 0; c < static_cast<int>(children.size()); c++)
     {
-        CTreeListItem* child = item->GetSortedChild(c);
-        InsertItem(i + 1 + c, child);
+        children[c] = item->GetSortedChild(c);
+    }
+    InsertItems(i + 1, children, static_cast<unsigned char>(m_Rows[i].indent + 1));
 
-        // The calculation of item width is very expensive for
-        // very large lists so limit calculation based on the
-        // first few bunch of visible items
-        if (scroll && c < 50)
-        {
-            maxwidth = max(maxwidth, GetSubItemWidth(child, 0));
-        }
+    // The calculation of item width is very expensive for
+    // very large lists so limit calculation based on the
+    // first few bunch of visible items
+    int maxwidth = GetSubItemWidth(item, 0);
+    for (int c = 0; scroll && c < min(static_cast<int>(children.size()), 50); c++)
+    {
+        maxwidth = max(maxwidth, GetSubItemWidth(GetVisibleItem(i + 1 + c), 0));
     }
-    UnlockWindowUpdate();
 
     if (scroll && GetColumnWidth(0) < maxwidth)
     {
         SetColumnWidth(0, maxwidth);
     }
 
-    item->SetExpanded(true);
     RedrawItems(i, i);
 
     if (scroll)
     {
         // Scroll up so far, that i is still visible
         // and the first child becomes visible, if possible.
-        if (item->GetTreeListChildCount() > 0)
+        if (item->GetSortedChildCount() > 0)
         {
             EnsureVisible(i + 1, false);
         }
@@ -818,6 +979,13 @@ void CTreeListControl::OnLvnItemchangingList(NMHDR* pNMHDR, LRESULT* pResult)
 {
     const auto pNMLV = reinterpret_cast<LPNMLISTVIEW>(pNMHDR);
 
+    // changes of all rows at once and our own changes are always allowed
+    if (pNMLV->iItem < 0 || m_UpdatingSelection)
+    {
+        *pResult = FALSE;
+        return;
+    }
+
     // determine if a new selection is being made
     const bool requestingSelection =
         (pNMLV->uOldState & LVIS_SELECTED) == 0 &&
@@ -825,7 +993,7 @@ void CTreeListControl::OnLvnItemchangingList(NMHDR* pNMHDR, LRESULT* pResult)
 
     // if in shift-extend mode, prevent selecting of non-adjacent nodes
     const auto shiftPressed = (HSHELL_HIGHBIT & GetKeyState(VK_SHIFT)) != 0;
-    if (shiftPressed && requestingSelection)
+    if (shiftPressed && requestingSelection && GetSelectionMark() != -1)
     {
         const auto& potentialSelection = GetItem(pNMLV->iItem);
         const auto& currentSelection = GetItem(GetSelectionMark());
@@ -852,7 +1020,67 @@ void CTreeListControl::OnLvnItemchangingList(NMHDR* pNMHDR, LRESULT* pResult)
     *pResult = FALSE;
 }
 
-void CTreeListControl::OnChildAdded(const CTreeListItem* parent, CTreeListItem* child)
+BOOL CTreeListControl::OnLvnItemchangedList(NMHDR* /*pNMHDR*/, LRESULT* pResult)
+{
+    // Moving the selection along with the rows is not a change for the parent
+    *pResult = FALSE;
+    return m_UpdatingSelection;
+}
+
+BOOL CTreeListControl::OnLvnOdstatechangedList(NMHDR* pNMHDR, LRESULT* pResult)
+{
+    const auto pStateChange = reinterpret_cast<LPNMLVODSTATECHANGE>(pNMHDR);
+    *pResult = FALSE;
+
+    // Range selections of a virtual list bypass LVN_ITEMCHANGING, so
+    // rows which are no siblings of the selection mark are deselected here
+    const CTreeListItem* mark = GetItem(GetSelectionMark());
+    if (m_UpdatingSelection || mark == nullptr || (pStateChange->uNewState & LVIS_SELECTED) == 0)
+    {
+        return m_UpdatingSelection;
+    }
+
+    m_UpdatingSelection = true;
+    for (int i = pStateChange->iFrom; i <= pStateChange->iTo; i++)
+    {
+        if (GetItem(i)->GetParent() != mark->GetParent())
+        {
+            SetItemState(i, 0, LVIS_SELECTED);
+        }
+    }
+    m_UpdatingSelection = false;
+
+    return FALSE;
+}
+
+void CTreeListControl::OnLvnOdfinditemList(NMHDR* pNMHDR, LRESULT* pResult)
+{
+    const auto pFindItem = reinterpret_cast<LPNMLVFINDITEM>(pNMHDR);
+    *pResult = -1;
+
+    // Incremental search by the typed beginning of the name
+    if ((pFindItem->lvfi.flags & LVFI_STRING) == 0 || m_Rows.empty())
+    {
+        return;
+    }
+
+    const bool partial = (pFindItem->lvfi.flags & (LVFI_PARTIAL | LVFI_SUBSTRING)) != 0;
+    const std::size_t length = wcslen(pFindItem->lvfi.psz);
+    const int count = static_cast<int>(m_Rows.size());
+    for (int k = 0; k < count; k++)
+    {
+        const int i = (max(pFindItem->iStart, 0) + k) % count;
+        const std::wstring text = m_Rows[i].item->GetText(0);
+        if (partial ? _wcsnicmp(text.c_str(), pFindItem->lvfi.psz, length) == 0 :
+            _wcsicmp(text.c_str(), pFindItem->lvfi.psz) == 0)
+        {
+            *pResult = i;
+            return;
+        }
+    }
+}
+
+void CTreeListControl::OnChildAdded(const CTreeListItem* parent, CTreeListItem* child, const bool sort)
 {
     if (!parent->IsVisible() || !parent->IsExpanded())
     {
@@ -861,12 +1089,55 @@ void CTreeListControl::OnChildAdded(const CTreeListItem* parent, CTreeListItem*
 
     const int p = FindTreeItem(parent);
     ASSERT(p != -1);
-    InsertItem(p + 1, child);
-    Sort();
+    InsertItem(p + 1, child, static_cast<unsigned char>(m_Rows[p].indent + 1));
+
+    // Callers adding many children at once may sort a single time afterward
+    if (sort) Sort();
 
     // NOTE: Redrawing is deffered to UI thread timer for performance
 }
 
+// Called by threads which must not wait on the UI thread; additions are
+// coalesced per parent until ProcessPostedChildren() lays them out
+void CTreeListControl::PostChildAdded(const CTreeListItem* parent)
+{
+    if (parent->SetChildrenPosted(true)) return;
+    m_PostedParents.Push(parent);
+}
+
+// Called by threads which must not wait on the UI thread; the child is already
+// detached from its parent and is deleted once its rows are gone
+void CTreeListControl::PostChildRemoved(CTreeListItem* parent, CTreeListItem* child)
+{
+    m_PostedRemovals.Push({ parent, child });
+}
+
+// Returns whether the rows were laid out again to show posted children,
+// which SortItems() turns into rows below their expanded parents
+bool CTreeListControl::ProcessPostedChildren()
+{
+    // Children posted as removed have no rows anymore, if the rows
+    // were laid out again since they were detached
+    for (const auto& [parent, child] : m_PostedRemovals.PopAll())
+    {
+        if (FindTreeItem(child) != -1) OnChildRemoved(parent, child);
+        delete child;
+    }
+
+    bool added = false;
+    for (const auto& parent : m_PostedParents.PopAll())
+    {
+        // Parents that are no longer rows have been collapsed or removed meanwhile;
+        // the flag is cleared before the children are sorted so none is missed
+        if (FindTreeItem(parent) == -1) continue;
+        parent->SetChildrenPosted(false);
+        added = added || parent->IsExpanded();
+    }
+
+    if (added) SortItems();
+    return added;
+}
+
 void CTreeListControl::OnChildRemoved(CTreeListItem* parent, CTreeListItem* child)
 {
     if (!parent->IsVisible())
@@ -910,15 +1181,50 @@ void CTreeListControl::OnRemovingAllChildren(const CTreeListItem* parent)
 
 void CTreeListControl::Sort()
 {
-    const int count = GetItemCount();
-    for (int i = 0; i < count; i++)
+    SortItems();
+}
+
+void CTreeListControl::SortItems()
+{
+    if (!m_Rows.empty())
     {
-        if (GetItem(i)->IsExpanded())
+        // The selection follows its items to their new rows
+        SELECTION selection = SaveSelection(0);
+        std::unordered_map<const CTreeListItem*, int> moved;
+        selection.Move([this, &moved](const int i) { moved.emplace(GetItem(i), -1); return i; });
+
+        // Sort the children of all expanded items and lay out the rows
+        // again, depth-first with the children below their parent; children
+        // posted by other threads become rows here
+        std::vector<ROW> rows;
+        rows.reserve(m_Rows.size());
+        for (std::vector stack = { m_Rows.front() }; !stack.empty();)
         {
-            GetItem(i)->SortChildren(GetSorting());
+            const ROW row = stack.back();
+            stack.pop_back();
+            if (const auto entry = moved.find(row.item); entry != moved.end()) entry->second = static_cast<int>(rows.size());
+            rows.push_back(row);
+
+            if (!row.expanded) continue;
+            row.item->SortChildren(GetSorting());
+            for (int c = row.item->GetSortedChildCount() - 1; c >= 0; c--)
+            {
+                CTreeListItem* child = row.item->GetSortedChild(c);
+                stack.push_back({ child, static_cast<unsigned char>(row.indent + 1), child->IsExpanded() });
+            }
         }
+        ASSERT(rows.size() >= m_Rows.size());
+        selection.Move([this, &moved](const int i) { return moved.at(GetItem(i)); });
+
+        const bool added = rows.size() != m_Rows.size();
+        m_Rows = std::move(rows);
+        if (added) SetItemCountEx(static_cast<int>(m_Rows.size()), LVSICF_NOSCROLL);
+
+        RestoreSelection(selection);
+        InvalidateRect(nullptr);
     }
-    COwnerDrawnListControl::SortItems();
+
+    IndicateSorting();
 }
 
 void CTreeListControl::EnsureItemVisible(const CTreeListItem* item)
@@ -23,7 +23,9 @@
 
 #include "OwnerDrawnListControl.h"
 #include "PacMan.h"
+#include "LockFreeQueue.h"
 
+#include <optional>
 #include <vector>
 
 class CFileTreeView;
@@ -32,8 +34,8 @@ class CTreeListControl;
 
 //
 // CTreeListItem. An item in the CTreeListControl. (CItem is derived from CTreeListItem.)
-// In order to save memory, once the item is actually inserted in the List,
-// we allocate the VISIBLEINFO structure (m_VisualInfo).
+// In order to save memory, the VISIBLEINFO structure (m_VisualInfo) is only allocated
+// once the row of the item comes on screen or the item is expanded.
 // m_VisualInfo is freed as soon as the item is removed from the List.
 //
 class CTreeListItem : public COwnerDrawnListItem
@@ -50,20 +52,33 @@ class CTreeListItem : public COwnerDrawnListItem
         CPacman pacman;
         CRect rcPlusMinus;    // Coordinates of the little +/- rectangle, relative to the upper left corner of the item.
         CRect rcTitle;        // Coordinates of the label, relative to the upper left corner of the item.
-        std::wstring owner;       // Owner of file or folder
+        std::optional<std::wstring> owner; // Owner of file or folder, once looked up
         short image = -1;     // -1 as long as not needed, >= 0: valid index in IconImageList.
-        unsigned char indent; // 0 for the root item, 1 for its children, and so on.
-        bool isExpanded = false; // Whether item is expanded.
+        unsigned char indent; // 0 for the root item, 1 for its children, and so on (as in its row).
+        bool isExpanded = false; // Whether item is expanded (as in its row).
         CTreeListControl* control = nullptr;
 
         VISIBLEINFO(const unsigned char iIndent) : indent(iIndent) {}
     };
 
 public:
+    // The sort key of an item for a subitem, extracted once per item before
+    // its siblings are sorted. The number is compared first and the text
+    // thereafter, ordinally, so it holds lower case text.
+    struct SORTKEY
+    {
+        ULONGLONG number = 0;
+        std::wstring text;
+
+        static SORTKEY FromText(std::wstring text);
+        int Compare(const SORTKEY& other) const;
+    };
+
     CTreeListItem() = default;
     ~CTreeListItem() override;
 
     virtual int CompareSibling(const CTreeListItem* tlib, int subitem) const = 0;
+    virtual SORTKEY GetSortKey(int subitem) const = 0;
 
     bool DrawSubitem(int subitem, CDC* pdc, CRect rc, UINT state, int* width, int* focusLeft) const override;
     std::wstring GetText(int subitem) const override;
@@ -71,12 +86,13 @@ public:
     int Compare(const CSortingListItem* baseOther, int subitem) const override;
     virtual CTreeListItem* GetTreeListChild(int i) const = 0;
     virtual int GetTreeListChildCount() const = 0;
-    virtual short GetImageToCache() const = 0;
+    virtual short GetImageToCache() const = 0; // -1 while the image is being resolved
 
     void DrawPacman(const CDC* pdc, const CRect& rc, COLORREF bgColor) const;
     void UnCacheImage();
     void SortChildren(const SSorting& sorting);
     CTreeListItem* GetSortedChild(int i) const;
+    int GetSortedChildCount() const;
     int FindSortedChild(const CTreeListItem* child) const;
     CTreeListItem* GetParent() const;
     void SetParent(CTreeListItem* parent);
@@ -84,7 +100,7 @@ public:
     bool HasSiblings() const;
     bool HasChildren() const;
     bool IsExpanded() const;
-    void SetExpanded(bool expanded = true);
+    virtual void SetExpanded(bool expanded = true);
     bool IsVisible() const { return m_VisualInfo != nullptr; }
     void SetVisible(CTreeListControl * control, bool visible = true);
     unsigned char GetIndent() const;
@@ -99,6 +115,11 @@ public:
     void StopPacman() const;
     void DrivePacman() const;
 
+    // Items whose children are added by other threads keep this flag apart
+    // from m_VisualInfo, which only the UI thread may touch. Returns whether
+    // children were posted already.
+    virtual bool SetChildrenPosted(bool /*posted*/) const { return false; }
+
 protected:
     mutable VISIBLEINFO* m_VisualInfo = nullptr;
 
@@ -108,6 +129,9 @@ private:
 
 //
 // CTreeListControl. A CListCtrl, which additionally behaves an looks like a tree control.
+// It is a virtual list (LVS_OWNERDATA): the rows are kept in m_Rows and the list view
+// only knows their count, so that it merely asks for the rows on screen, whose
+// items get their visual state then.
 //
 class CTreeListControl : public COwnerDrawnListControl
 {
@@ -119,16 +143,22 @@ class CTreeListControl : public COwnerDrawnListControl
     virtual BOOL CreateEx(DWORD dwExStyle, DWORD dwStyle, const RECT& rect, CWnd* pParentWnd, UINT nID);
     void SysColorChanged() override;
     virtual void SetRootItem(CTreeListItem* root);
-    void OnChildAdded(const CTreeListItem* parent, CTreeListItem* child);
+    void OnChildAdded(const CTreeListItem* parent, CTreeListItem* child, bool sort = true);
     void OnChildRemoved(CTreeListItem* parent, CTreeListItem* child);
     void OnRemovingAllChildren(const CTreeListItem* parent);
+    void PostChildAdded(const CTreeListItem* parent);
+    void PostChildRemoved(CTreeListItem* parent, CTreeListItem* child);
+    bool ProcessPostedChildren();
     CTreeListItem* GetItem(int i) const;
+    CSortingListItem* GetSortingListItem(int i) const override;
+    int FindListItem(const COwnerDrawnListItem* item) const override;
     bool IsItemSelected(const CTreeListItem* item) const;
     void SelectItem(const CTreeListItem* item, bool deselect = false, bool focus = false);
     void DeselectAll();
     void ExpandPathToItem(const CTreeListItem* item);
     void DrawNode(CDC* pdc, CRect& rc, CRect& rcPlusMinus, const CTreeListItem* item, int* width);
     void Sort();
+    void SortItems() override;
     void EnsureItemVisible(const CTreeListItem* item);
     void ExpandItem(const CTreeListItem* item);
     int FindTreeItem(const CTreeListItem* item) const;
@@ -161,10 +191,40 @@ class CTreeListControl : public COwnerDrawnListControl
     }
 
 protected:
+    // A row only holds the tree state needed to lay out the rows
+    struct ROW
+    {
+        CTreeListItem* item;
+        unsigned char indent;
+        bool expanded;
+    };
+
+    // The selection of the list view refers to row indices, -1 for none
+    struct SELECTION
+    {
+        std::vector<int> selected;
+        int focused = -1;
+        int mark = -1;
+
+        // Moves the rows to their new indices, where -1 drops them
+        template <class F> void Move(F moved)
+        {
+            for (auto& i : selected) i = moved(i);
+            if (focused != -1) focused = moved(focused);
+            if (mark != -1) mark = moved(mark);
+        }
+    };
+
     virtual void OnItemDoubleClick(int i);
     void InitializeNodeBitmaps();
-    void InsertItem(int i, CTreeListItem* item);
+    CTreeListItem* GetVisibleItem(int i) const;
+    void InsertItem(int i, CTreeListItem* item, unsigned char indent);
+    void InsertItems(int i, const std::vector<CTreeListItem*>& items, unsigned char indent);
     void DeleteItem(int i);
+    void DeleteItems(int i, int count);
+    SELECTION SaveSelection(int first);
+    void RestoreSelection(const SELECTION& selection);
+    void SetRowExpanded(int i, bool expanded);
     void CollapseItem(int i);
     void ExpandItem(int i, bool scroll = true);
     void ToggleExpansion(int i);
@@ -175,6 +235,10 @@ protected:
     CBitmap m_BmNodes0;                // The bitmaps needed to draw the treecontrol-like branches
     CBitmap m_BmNodes1;                // The same bitmaps with stripe-background color
     CImageList* m_ImageList = nullptr; // We don't use the system-supplied SetImageList(), but MySetImageList().
+    std::vector<ROW> m_Rows;           // The tree state of the items in the order of the rows
+    bool m_UpdatingSelection = false;  // Whether the selection is changed by ourselves
+    LockFreeQueue<const CTreeListItem*> m_PostedParents; // Parents whose children were added by other threads
+    LockFreeQueue<std::pair<CTreeListItem*, CTreeListItem*>> m_PostedRemovals; // Parents and children removed by other threads
     int m_LButtonDownItem = -1;        // Set in OnLButtonDown(). -1 if not item hit.
     bool m_LButtonDownOnPlusMinusRect = false; // Set in OnLButtonDown(). True, if plus-minus-rect hit.
 
@@ -184,5 +248,8 @@ protected:
     afx_msg void OnLButtonDown(UINT nFlags, CPoint point);
     afx_msg void OnLButtonDblClk(UINT nFlags, CPoint point);
     afx_msg void OnLvnItemchangingList(NMHDR* pNMHDR, LRESULT* pResult);
+    afx_msg BOOL OnLvnItemchangedList(NMHDR* pNMHDR, LRESULT* pResult);
+    afx_msg BOOL OnLvnOdstatechangedList(NMHDR* pNMHDR, LRESULT* pResult);
+    afx_msg void OnLvnOdfinditemList(NMHDR* pNMHDR, LRESULT* pResult);
     afx_msg void OnKeyDown(UINT nChar, UINT nRepCnt, UINT nFlags);
 };
@@ -22,7 +22,16 @@
 #include "stdafx.h"
 #include "SelectObject.h"
 #include "TreeMap.h"
+#include "TreeMapLayout.h"
 
+#include <common/Tracer.h>
+
+#include <chrono>
+#include <execution>
+#include <immintrin.h>
+#include <ranges>
+#include <thread>
+#include <utility>
 #include <vector>
 
 constexpr COLORREF BGR(auto b, auto g, auto r)
@@ -38,6 +47,209 @@ constexpr COLORREF BGR(auto b, auto g, auto r)
 
 static constexpr double PALETTE_BRIGHTNESS = 0.6;
 
+#ifndef PF_SSE4_1_INSTRUCTIONS_AVAILABLE
+#define PF_SSE4_1_INSTRUCTIONS_AVAILABLE 37
+#endif
+#ifndef PF_AVX2_INSTRUCTIONS_AVAILABLE
+#define PF_AVX2_INSTRUCTIONS_AVAILABLE 40
+#endif
+
+namespace
+{
+    // Everything the cushion kernels need to shade one row of a rectangle
+    struct CUSHIONROW
+    {
+        double s0;     // Horizontal surface coefficients
+        double s2;
+        double ny;     // Normal y component, constant along the row
+        double lx;     // Normalized light source vector
+        double ly;
+        double lz;
+        double ia;     // Ambient light
+        double is;     // Shading (1 - ambient light)
+        double factor; // Brightness relative to the palette brightness
+        double colR;
+        double colG;
+        double colB;
+        int left;      // x coordinate of the first pixel
+    };
+
+    // Reference implementation; per pixel in double precision
+    void ShadeCushionRowScalar(COLORREF* out, const int count, const CUSHIONROW& p)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            const double nx = -(2 * p.s0 * (p.left + i + 0.5) + p.s2);
+            double cosa     = (nx * p.lx + p.ny * p.ly + p.lz) / sqrt(nx * nx + p.ny * p.ny + 1.0);
+            if (cosa > 1.0)
+            {
+                cosa = 1.0;
+            }
+
+            double pixel = p.is * cosa;
+            if (pixel < 0)
+            {
+                pixel = 0;
+            }
+
+            pixel += p.ia;
+            ASSERT(pixel <= 1.0);
+
+            // Now, pixel is the brightness of the pixel, 0...1.0.
+
+            // Apply contrast.
+            // Not implemented.
+            // Costs performance and nearly the same effect can be
+            // made width the m_Options->ambientLight parameter.
+            // pixel = pow(pixel, m_Options->contrast);
+
+            // Apply "brightness"
+            pixel *= p.factor;
+
+            // Make color value
+            int red   = static_cast<int>(p.colR * pixel);
+            int green = static_cast<int>(p.colG * pixel);
+            int blue  = static_cast<int>(p.colB * pixel);
+
+            CColorSpace::NormalizeColor(red, green, blue);
+
+            // ... and set!
+            out[i] = BGR(blue, green, red);
+        }
+    }
+
+    // The x component of the normal is computed in double precision for the
+    // first pixel and then advanced in float, which avoids the cancellation
+    // of the large surface coefficients. Chunks with a channel above 255
+    // (bright colors at the top of a cushion) are rare and are redone by the
+    // reference implementation, as NormalizeColor() would amplify the float
+    // rounding error.
+
+    void ShadeCushionRowSSE41(COLORREF* out, const int count, const CUSHIONROW& p)
+    {
+        const __m128 nx0    = _mm_set1_ps(static_cast<float>(-(2 * p.s0 * (p.left + 0.5) + p.s2)));
+        const __m128 dnx    = _mm_set1_ps(static_cast<float>(-2 * p.s0));
+        const __m128 lanes  = _mm_setr_ps(0, 1, 2, 3);
+        const __m128 lx     = _mm_set1_ps(static_cast<float>(p.lx));
+        const __m128 nyLz   = _mm_set1_ps(static_cast<float>(p.ny * p.ly + p.lz));
+        const __m128 ny2    = _mm_set1_ps(static_cast<float>(p.ny * p.ny + 1.0));
+        const __m128 is     = _mm_set1_ps(static_cast<float>(p.is));
+        const __m128 ia     = _mm_set1_ps(static_cast<float>(p.ia));
+        const __m128 factor = _mm_set1_ps(static_cast<float>(p.factor));
+        const __m128 colR   = _mm_set1_ps(static_cast<float>(p.colR));
+        const __m128 colG   = _mm_set1_ps(static_cast<float>(p.colG));
+        const __m128 colB   = _mm_set1_ps(static_cast<float>(p.colB));
+        const __m128 one    = _mm_set1_ps(1.0f);
+        const __m128 zero   = _mm_setzero_ps();
+        const __m128i limit = _mm_set1_epi32(255);
+
+        for (int i = 0; i < count; i += 4)
+        {
+            const __m128 nx = _mm_add_ps(nx0, _mm_mul_ps(dnx, _mm_add_ps(_mm_set1_ps(static_cast<float>(i)), lanes)));
+            __m128 cosa     = _mm_div_ps(_mm_add_ps(_mm_mul_ps(nx, lx), nyLz), _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(nx, nx), ny2)));
+            cosa            = _mm_min_ps(cosa, one);
+            __m128 pixel    = _mm_add_ps(_mm_max_ps(_mm_mul_ps(is, cosa), zero), ia);
+            pixel           = _mm_mul_ps(pixel, factor);
+
+            const __m128i red   = _mm_cvttps_epi32(_mm_mul_ps(colR, pixel));
+            const __m128i green = _mm_cvttps_epi32(_mm_mul_ps(colG, pixel));
+            const __m128i blue  = _mm_cvttps_epi32(_mm_mul_ps(colB, pixel));
+            const __m128i over  = _mm_cmpgt_epi32(_mm_max_epi32(red, _mm_max_epi32(green, blue)), limit);
+            const __m128i bgr   = _mm_or_si128(blue, _mm_or_si128(_mm_slli_epi32(green, 8), _mm_slli_epi32(red, 16)));
+
+            const int n = min(4, count - i);
+            if (!_mm_testz_si128(over, over))
+            {
+                CUSHIONROW chunk = p;
+                chunk.left += i;
+                ShadeCushionRowScalar(out + i, n, chunk);
+            }
+            else if (n == 4)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bgr);
+            }
+            else
+            {
+                alignas(16) COLORREF px[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(px), bgr);
+                std::copy_n(px, n, out + i);
+            }
+        }
+    }
+
+    void ShadeCushionRowAVX2(COLORREF* out, const int count, const CUSHIONROW& p)
+    {
+        const __m256 nx0    = _mm256_set1_ps(static_cast<float>(-(2 * p.s0 * (p.left + 0.5) + p.s2)));
+        const __m256 dnx    = _mm256_set1_ps(static_cast<float>(-2 * p.s0));
+        const __m256 lanes  = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256 lx     = _mm256_set1_ps(static_cast<float>(p.lx));
+        const __m256 nyLz   = _mm256_set1_ps(static_cast<float>(p.ny * p.ly + p.lz));
+        const __m256 ny2    = _mm256_set1_ps(static_cast<float>(p.ny * p.ny + 1.0));
+        const __m256 is     = _mm256_set1_ps(static_cast<float>(p.is));
+        const __m256 ia     = _mm256_set1_ps(static_cast<float>(p.ia));
+        const __m256 factor = _mm256_set1_ps(static_cast<float>(p.factor));
+        const __m256 colR   = _mm256_set1_ps(static_cast<float>(p.colR));
+        const __m256 colG   = _mm256_set1_ps(static_cast<float>(p.colG));
+        const __m256 colB   = _mm256_set1_ps(static_cast<float>(p.colB));
+        const __m256 one    = _mm256_set1_ps(1.0f);
+        const __m256 zero   = _mm256_setzero_ps();
+        const __m256i limit = _mm256_set1_epi32(255);
+
+        for (int i = 0; i < count; i += 8)
+        {
+            const __m256 nx = _mm256_add_ps(nx0, _mm256_mul_ps(dnx, _mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)), lanes)));
+            __m256 cosa     = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(nx, lx), nyLz), _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(nx, nx), ny2)));
+            cosa            = _mm256_min_ps(cosa, one);
+            __m256 pixel    = _mm256_add_ps(_mm256_max_ps(_mm256_mul_ps(is, cosa), zero), ia);
+            pixel           = _mm256_mul_ps(pixel, factor);
+
+            const __m256i red   = _mm256_cvttps_epi32(_mm256_mul_ps(colR, pixel));
+            const __m256i green = _mm256_cvttps_epi32(_mm256_mul_ps(colG, pixel));
+            const __m256i blue  = _mm256_cvttps_epi32(_mm256_mul_ps(colB, pixel));
+            const __m256i over  = _mm256_cmpgt_epi32(_mm256_max_epi32(red, _mm256_max_epi32(green, blue)), limit);
+            const __m256i bgr   = _mm256_or_si256(blue, _mm256_or_si256(_mm256_slli_epi32(green, 8), _mm256_slli_epi32(red, 16)));
+
+            const int n = min(8, count - i);
+            if (!_mm256_testz_si256(over, over))
+            {
+                CUSHIONROW chunk = p;
+                chunk.left += i;
+                ShadeCushionRowScalar(out + i, n, chunk);
+            }
+            else if (n == 8)
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), bgr);
+            }
+            else
+            {
+                alignas(32) COLORREF px[8];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(px), bgr);
+                std::copy_n(px, n, out + i);
+            }
+        }
+    }
+
+    using CushionRowKernel = void(*)(COLORREF* out, int count, const CUSHIONROW& p);
+
+    CushionRowKernel SelectCushionRowKernel()
+    {
+        if (::IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE))
+        {
+            return ShadeCushionRowAVX2;
+        }
+
+        if (::IsProcessorFeaturePresent(PF_SSE4_1_INSTRUCTIONS_AVAILABLE))
+        {
+            return ShadeCushionRowSSE41;
+        }
+
+        return ShadeCushionRowScalar;
+    }
+
+    // Only replaced while measuring the kernels (see MeasureCushionShading())
+    CushionRowKernel ShadeCushionRow = SelectCushionRowKernel();
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 double CColorSpace::GetColorBrightness(const COLORREF color)
@@ -121,7 +333,8 @@ const CTreeMap::Options CTreeMap::_defaultOptions = {
     0.91,
     0.13,
     -1.0,
-    -1.0
+    -1.0,
+    0
 };
 
 const CTreeMap::Options CTreeMap::_defaultOptionsOld = {
@@ -133,7 +346,8 @@ const CTreeMap::Options CTreeMap::_defaultOptionsOld = {
     0.9,
     0.15,
     -1.0,
-    -1.0
+    -1.0,
+    0
 };
 
 const COLORREF CTreeMap::_defaultCushionColors[] = {
@@ -264,38 +478,91 @@ void CTreeMap::DrawTreeMap(CDC* pdc, CRect rc, Item* root, const Options* option
         return;
     }
 
-    m_RenderArea = rc;
+    CRect baserc;
+    CRect visiblerc;
+    CalculateViewport(rc.Size(), baserc, visiblerc);
+    const std::size_t optionsHash = HashOptions(m_Options);
 
-    if (root->TmiGetSize() > 0)
+    // Apply a pending change of a subtree to the current layout and
+    // rendering. If this is not possible, they are dropped entirely.
+    if (!m_PendingPath.empty())
     {
-        // Create a temporary CDC that represents only the tree map
-        CDC dcTreeView;
-        VERIFY(dcTreeView.CreateCompatibleDC(pdc));
-
-        // This bitmap will be blitted onto the temporary DC
-        CBitmap bmp;
+        int kept = -1;
+        std::vector<int> dirty;
+        m_LastUpdate.reset();
+        const auto startTime = std::chrono::steady_clock::now();
+        if (IsLayoutCurrent(root, baserc, visiblerc) && m_BitmapOptions == optionsHash &&
+            m_BitmapBits.size() == static_cast<std::size_t>(rc.Width()) * rc.Height())
+        {
+            kept = UpdateLayout(m_PendingPath, dirty);
+        }
+        m_PendingPath.clear();
 
-        // That bitmap in turn will be created from this array
-        std::vector<COLORREF> bitmapBits;
-        bitmapBits.resize(rc.Width() * rc.Height());
+        if (kept >= 0)
+        {
+            m_RenderArea = visiblerc;
 
-        // Recursively draw the tree graph
-        constexpr double surface[4] = {0, 0, 0, 0};
-        const CRect baserc({ 0,0 }, rc.Size());
-        RecurseDrawGraph(bitmapBits, root, baserc, true, surface, m_Options.height, 0);
+            // The subtrees laid out anew cover all pixels which may have changed
+            LONGLONG pixels = 0;
+            for (const int first : dirty)
+            {
+                const LAYOUTITEM& entry = m_Layout[first];
+                CRect area;
+                area.IntersectRect(entry.rc, visiblerc);
+                for (int y = area.top; y < area.bottom; y++)
+                {
+                    std::fill_n(m_BitmapBits.begin() + (static_cast<std::size_t>(y - visiblerc.top) * rc.Width() + area.left - visiblerc.left), area.Width(), 0);
+                }
+                RenderLayout(m_BitmapBits, first, entry.next);
+                pixels += static_cast<LONGLONG>(area.Width()) * area.Height();
+            }
 
-        // Fill the bitmap with the array
-        VERIFY(bmp.CreateBitmap(rc.Width(), rc.Height(), 1, 32, bitmapBits.data()));
+            m_UpdatedEntries += m_Layout.size();
+            m_KeptEntries += kept;
+            m_LastUpdate = UPDATESTATS{ pixels, static_cast<LONGLONG>(rc.Width()) * rc.Height(), kept, m_Layout.size(),
+                100.0 * m_KeptEntries / m_UpdatedEntries,
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() };
+        }
+        else
+        {
+            ClearLayout();
+        }
+    }
 
-        // Render bitmap to the temporary CDC
-        dcTreeView.SelectObject(&bmp);
+    // Switch to the layout of a root shown before, if it is still cached.
+    // Magnified layouts only cover the visible part and are not cached.
+    if (!IsLayoutCurrent(root, baserc, visiblerc))
+    {
+        StoreInCache();
+        if (visiblerc == baserc)
+        {
+            RestoreFromCache(root, baserc);
+        }
+    }
 
-        // And lastly, draw the temporary CDC to the real one
-        VERIFY(pdc->BitBlt(rc.TopLeft().x, rc.TopLeft().y, rc.Width(), rc.Height(), &dcTreeView, 0, 0, SRCCOPY));
+    // The framebuffer is kept between calls and only rendered again,
+    // if the layout or the options have changed
+    bool drawn = root->TmiGetSize() > 0;
+    if (!IsLayoutCurrent(root, baserc, visiblerc) || m_BitmapOptions != optionsHash ||
+        m_BitmapBits.size() != static_cast<std::size_t>(rc.Width()) * rc.Height())
+    {
+        drawn = RenderViewport(m_BitmapBits, root, baserc, visiblerc);
+        m_BitmapOptions = drawn ? optionsHash : 0;
+    }
 
-        // Free memory
-        VERIFY(bmp.DeleteObject());
-        VERIFY(dcTreeView.DeleteDC());
+    if (drawn)
+    {
+        // Copy the framebuffer directly to the DC as a top-down DIB,
+        // without creating a bitmap and a temporary DC
+        BITMAPINFO bmi = {};
+        bmi.bmiHeader.biSize        = sizeof(bmi.bmiHeader);
+        bmi.bmiHeader.biWidth       = rc.Width();
+        bmi.bmiHeader.biHeight      = -rc.Height();
+        bmi.bmiHeader.biPlanes      = 1;
+        bmi.bmiHeader.biBitCount    = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        VERIFY(::SetDIBitsToDevice(pdc->m_hDC, rc.left, rc.top, rc.Width(), rc.Height(),
+            0, 0, 0, rc.Height(), m_BitmapBits.data(), &bmi, DIB_RGB_COLORS) != 0);
 
 #ifdef STRONGDEBUG  // slow, but finds bugs!
 #ifdef _DEBUG
@@ -303,7 +570,7 @@ void CTreeMap::DrawTreeMap(CDC* pdc, CRect rc, Item* root, const Options* option
         {
             for(int y = rc.top; y < rc.bottom - m_Options.grid; y++)
             {
-                ASSERT(FindItemByPoint(root, CPoint(x, y)) != NULL);
+                ASSERT(FindItemByPoint(CPoint(x, y)) != NULL);
             }
         }
 #endif
@@ -315,6 +582,70 @@ void CTreeMap::DrawTreeMap(CDC* pdc, CRect rc, Item* root, const Options* option
     }
 }
 
+bool CTreeMap::RenderTreeMap(std::vector<COLORREF>& bitmap, const CSize& size, Item* root, const Options* options)
+{
+    if (options != nullptr)
+    {
+        SetOptions(options);
+    }
+
+    const CRect rc(CPoint(0, 0), CSize(max(size.cx, 0), max(size.cy, 0)));
+    return RenderViewport(bitmap, root, rc, rc);
+}
+
+bool CTreeMap::RenderViewport(std::vector<COLORREF>& bitmap, Item* root, const CRect& rc, const CRect& visible)
+{
+    bitmap.assign(static_cast<std::size_t>(visible.Width()) * visible.Height(), 0);
+
+    if (visible.Width() <= 0 || visible.Height() <= 0 || root->TmiGetSize() == 0)
+    {
+        InvalidateLayout();
+        return false;
+    }
+
+    // A pending change of a subtree is only applied by DrawTreeMap()
+    if (!m_PendingPath.empty())
+    {
+        ClearLayout();
+    }
+
+    m_RenderArea = visible;
+
+    // Lay out the tree, unless only the shading has changed
+    auto startTime = std::chrono::steady_clock::now();
+    if (!IsLayoutCurrent(root, rc, visible))
+    {
+        Layout(root, rc, visible);
+        VTRACE(L"Treemap layout of {} items in {} ms", m_Layout.size(),
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count());
+        startTime = std::chrono::steady_clock::now();
+    }
+    else if (m_SurfaceHeight != m_Options.height || m_SurfaceScaleFactor != m_Options.scaleFactor)
+    {
+        ComputeSurfaces(0, m_Layout.size());
+    }
+
+    RenderLayout(bitmap, 0, static_cast<int>(m_Layout.size()));
+
+    const auto renderTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    VTRACE(L"Treemap rendered {}x{} in {:.1f} ms ({:.1f} Mpixel/s)", visible.Width(), visible.Height(),
+        renderTime, visible.Width() * visible.Height() / max(renderTime, 0.001) / 1000.0);
+
+    return true;
+}
+
+void CTreeMap::LayoutTreeMap(Item* root, const CSize& size)
+{
+    if (size.cx <= 0 || size.cy <= 0 || root->TmiGetSize() == 0)
+    {
+        InvalidateLayout();
+        return;
+    }
+
+    const CRect rc(CPoint(0, 0), size);
+    Layout(root, rc, rc);
+}
+
 void CTreeMap::DrawTreeMapDoubleBuffered(CDC* pdc, const CRect& rc, Item* root, const Options* options)
 {
     if (options != nullptr)
@@ -342,646 +673,683 @@ void CTreeMap::DrawTreeMapDoubleBuffered(CDC* pdc, const CRect& rc, Item* root,
     VERIFY(pdc->BitBlt(rc.left, rc.top, rc.Width(), rc.Height(), &dc, 0, 0, SRCCOPY));
 }
 
-CTreeMap::Item* CTreeMap::FindItemByPoint(Item* item, const CPoint point)
+void CTreeMap::InvalidateLayout()
 {
-    ASSERT(item != nullptr);
-    const CRect& rc = item->TmiGetRectangle();
+    ClearLayout();
+    m_Cache.clear();
+}
 
-    if (!rc.PtInRect(point))
+void CTreeMap::InvalidateLayout(const std::function<bool(const Item* root)>& affected)
+{
+    if (m_LayoutRoot != nullptr && affected(m_LayoutRoot))
     {
-        // The only case that this function returns NULL is that
-        // point is not inside the rectangle of item.
-        //
-        // Take notice of
-        // (a) the very right an bottom lines, which can be "grid" and
-        //     are not covered by the root rectangle,
-        // (b) the fact, that WM_MOUSEMOVEs can occur after WM_SIZE but
-        //     before WM_PAINT.
-        //
-        return nullptr;
+        ClearLayout();
     }
 
-    ASSERT(rc.PtInRect(point));
-
-    Item* ret = nullptr;
+    std::erase_if(m_Cache, [&](const CACHEENTRY& entry) { return affected(entry.root); });
+}
 
-    const int gridWidth = m_Options.grid ? 1 : 0;
+void CTreeMap::InvalidateSubtree(const std::vector<Item*>& path, const std::function<bool(const Item* root)>& affected)
+{
+    ASSERT(!path.empty());
 
-    if (rc.Width() <= gridWidth ||
-        rc.Height() <= gridWidth ||
-        item->TmiIsLeaf())
+    // Several changes before the next DrawTreeMap() are combined
+    // into one below their deepest common item
+    if (m_Layout.empty())
+    {
+        m_PendingPath.clear();
+    }
+    else if (m_PendingPath.empty())
     {
-        ret = item;
+        m_PendingPath = path;
     }
     else
     {
-        ASSERT(item->TmiGetSize() > 0);
-        ASSERT(item->TmiGetChildCount() > 0);
-
-        for (int i = 0; i < item->TmiGetChildCount(); i++)
+        const auto [pending, other] = std::ranges::mismatch(m_PendingPath, path);
+        m_PendingPath.erase(pending, m_PendingPath.end());
+        if (m_PendingPath.empty())
         {
-            Item* child = item->TmiGetChild(i);
-
-            ASSERT(child->TmiGetSize() > 0);
-
-#ifdef _DEBUG
-            CRect rcChild(child->TmiGetRectangle());
-            ASSERT(rcChild.right >= rcChild.left);
-            ASSERT(rcChild.bottom >= rcChild.top);
-            ASSERT(rcChild.left >= rc.left);
-            ASSERT(rcChild.right <= rc.right);
-            ASSERT(rcChild.top >= rc.top);
-            ASSERT(rcChild.bottom <= rc.bottom);
-#endif
-            if (child->TmiGetRectangle().PtInRect(point))
-            {
-                ret = FindItemByPoint(child, point);
-                ASSERT(ret != nullptr);
-#ifdef STRONGDEBUG
-#ifdef _DEBUG
-                for(i++; i < item->TmiGetChildCount(); i++)
-                {
-                    child = item->TmiGetChild(i);
-
-                    if(child->TmiGetSize() == 0)
-                    {
-                        break;
-                    }
-
-                    rcChild = child->TmiGetRectangle();
-                    if(rcChild.left == -1)
-                    {
-                        ASSERT(rcChild.top == -1);
-                        ASSERT(rcChild.right == -1);
-                        ASSERT(rcChild.bottom == -1);
-                        break;
-                    }
-
-                    ASSERT(rcChild.right >= rcChild.left);
-                    ASSERT(rcChild.bottom >= rcChild.top);
-                    ASSERT(rcChild.left >= rc.left);
-                    ASSERT(rcChild.right <= rc.right);
-                    ASSERT(rcChild.top >= rc.top);
-                    ASSERT(rcChild.bottom <= rc.bottom);
-                }
-#endif
-#endif
-
-                break;
-            }
+            ClearLayout();
         }
     }
 
-    ASSERT(ret != nullptr);
+    std::erase_if(m_Cache, [&](const CACHEENTRY& entry) { return affected(entry.root); });
+}
 
-    if (ret == nullptr)
+void CTreeMap::InvalidateBitmaps()
+{
+    m_BitmapOptions = 0;
+    for (auto& entry : m_Cache)
     {
-        ret = item;
+        entry.bytes -= entry.bitmap.capacity() * sizeof(COLORREF);
+        entry.bitmap = {};
+        entry.bitmapOptions = 0;
     }
+}
 
-    return ret;
+bool CTreeMap::IsLayoutCurrent(const Item* root, const CRect& rc, const CRect& visible) const
+{
+    return !m_Layout.empty() && m_LayoutRoot == root && m_LayoutRect == rc && m_LayoutVisible == visible &&
+        m_LayoutStyle == m_Options.style && m_LayoutGrid == m_Options.grid &&
+        m_LayoutMinimumArea == m_Options.minimumArea;
 }
 
-void CTreeMap::DrawColorPreview(CDC* pdc, const CRect& rc, const COLORREF color, const Options* options)
+void CTreeMap::StoreInCache()
 {
-    if (options != nullptr)
+    if (m_LayoutVisible != m_LayoutRect)
     {
-        SetOptions(options);
+        ClearLayout();
     }
 
-    double surface[4] = {0, 0, 0, 0};
-    AddRidge(rc, surface, m_Options.height * m_Options.scaleFactor);
-
-    m_RenderArea = rc;
-
-    // Create a temporary CDC that represents only the tree map
-    CDC dcTreeView;
-    VERIFY(dcTreeView.CreateCompatibleDC(pdc));
-
-    // This bitmap will be blitted onto the temporary DC
-    CBitmap bmp;
-
-    // That bitmap in turn will be created from this array
-    std::vector<COLORREF> bitmapBits;
-    bitmapBits.resize(rc.Width() * rc.Height());
-
-    // Recursively draw the tree graph
-    RenderRectangle(bitmapBits, CRect(0, 0, rc.Width(), rc.Height()), surface, color);
+    if (m_Layout.empty())
+    {
+        return;
+    }
 
-    // Fill the bitmap with the array
-    VERIFY(bmp.CreateBitmap(rc.Width(), rc.Height(), 1, 32, bitmapBits.data()));
+    CACHEENTRY entry{ m_LayoutRoot, m_LayoutRect, m_LayoutStyle, m_LayoutGrid, m_LayoutMinimumArea,
+        m_SurfaceHeight, m_SurfaceScaleFactor, std::move(m_Layout), std::move(m_GroupRectangles),
+        {}, m_BitmapOptions, 0 };
+    if (m_BitmapOptions != 0)
+    {
+        entry.bitmap = std::move(m_BitmapBits);
+    }
 
-    // Render bitmap to the temporary CDC
-    dcTreeView.SelectObject(&bmp);
+    entry.bytes = entry.layout.capacity() * sizeof(LAYOUTITEM) + entry.bitmap.capacity() * sizeof(COLORREF);
+    for (const auto& rectangles : entry.groupRectangles | std::views::values)
+    {
+        entry.bytes += rectangles.capacity() * sizeof(CRect);
+    }
 
-    // And lastly, draw the temporary CDC to the real one
-    VERIFY(pdc->BitBlt(rc.TopLeft().x, rc.TopLeft().y, rc.Width(), rc.Height(), &dcTreeView, 0, 0, SRCCOPY));
+    m_Cache.emplace_front(std::move(entry));
+    ClearLayout();
 
-    if (m_Options.grid)
+    // Drop the least recently used entries beyond the memory budget
+    std::size_t bytes = 0;
+    for (auto it = m_Cache.begin(); it != m_Cache.end();)
     {
-        CPen pen(PS_SOLID, 1, m_Options.gridColor);
-        CSelectObject sopen(pdc, &pen);
-        CSelectStockObject sobrush(pdc, NULL_BRUSH);
-        VERIFY(pdc->Rectangle(rc));
+        bytes += it->bytes;
+        it = bytes > CACHE_SIZE ? m_Cache.erase(it) : std::next(it);
     }
-
-    // Free memory
-    VERIFY(bmp.DeleteObject());
-    VERIFY(dcTreeView.DeleteDC());
 }
 
-void CTreeMap::RecurseDrawGraph(std::vector<COLORREF>& bitmap, Item* item, const CRect& rc,
-    const bool asroot, const double* psurface, const double h, const DWORD flags)
+void CTreeMap::ClearLayout()
 {
-    ASSERT(rc.Width() >= 0);
-    ASSERT(rc.Height() >= 0);
-
-    ASSERT(item->TmiGetSize() > 0);
-
-    item->TmiSetRectangle(rc);
-
-    const int gridWidth = m_Options.grid ? 1 : 0;
+    m_Layout.clear();
+    m_GroupRectangles.clear();
+    m_LayoutRoot = nullptr;
+    m_BitmapOptions = 0;
+    m_PendingPath.clear();
+    m_IndexCells.clear();
+    m_IndexEntries.clear();
+}
 
-    if (rc.Width() <= gridWidth || rc.Height() <= gridWidth)
+bool CTreeMap::RestoreFromCache(const Item* root, const CRect& rc)
+{
+    const auto entry = std::ranges::find_if(m_Cache, [&](const CACHEENTRY& e)
     {
-        return;
+        return e.root == root && e.rect == rc && e.style == m_Options.style &&
+            e.grid == m_Options.grid && e.minimumArea == m_Options.minimumArea;
+    });
+    if (entry == m_Cache.end())
+    {
+        return false;
     }
 
-    double surface[4] = {0, 0, 0, 0};
-    if (IsCushionShading())
+    m_LayoutRoot         = entry->root;
+    m_LayoutRect         = entry->rect;
+    m_LayoutVisible      = entry->rect;
+    m_LayoutStyle        = entry->style;
+    m_LayoutGrid         = entry->grid;
+    m_LayoutMinimumArea  = entry->minimumArea;
+    m_SurfaceHeight      = entry->surfaceHeight;
+    m_SurfaceScaleFactor = entry->surfaceScaleFactor;
+    m_Layout             = std::move(entry->layout);
+    m_GroupRectangles    = std::move(entry->groupRectangles);
+    if (entry->bitmapOptions != 0)
     {
-        for (unsigned int i = 0; i < _countof(surface); i++)
-        {
-            surface[i] = psurface[i];
-        }
-
-        if (!asroot)
-        {
-            AddRidge(rc, surface, h);
-        }
+        m_BitmapBits = std::move(entry->bitmap);
     }
+    m_BitmapOptions      = entry->bitmapOptions;
+    m_Cache.erase(entry);
 
-    if (item->TmiIsLeaf())
+    // The items still carry the rectangles of the last layout
+    for (const auto& item : m_Layout)
     {
-        RenderLeaf(bitmap, item, surface);
+        item.item->TmiSetRectangle(item.rc);
     }
-    else
-    {
-        ASSERT(item->TmiGetChildCount() > 0);
-        ASSERT(item->TmiGetSize() > 0);
+    BuildIndex();
 
-        DrawChildren(bitmap, item, surface, h, flags);
-    }
+    return true;
 }
 
-// My first approach was to make this member pure virtual and have three
-// classes derived from CTreeMap. The disadvantage is then, that we cannot
-// simply have a member variable of type CTreeMap but have to deal with
-// pointers, factory methods and explicit destruction. It's not worth.
-
-void CTreeMap::DrawChildren(std::vector<COLORREF>& bitmap, const Item* parent,
-    const double* surface, const double h, const DWORD flags)
+std::size_t CTreeMap::HashOptions(const Options& options)
 {
-    switch (m_Options.style)
+    std::size_t hash = 0;
+    const auto combine = [&hash](const auto& value)
     {
-    case KDirStatStyle:
-        {
-            KDirStat_DrawChildren(bitmap, parent, surface, h, flags);
-        }
-        break;
-
-    case SequoiaViewStyle:
-        {
-            SequoiaView_DrawChildren(bitmap, parent, surface, h, flags);
-        }
-        break;
-    }
+        hash = hash * 31 + std::hash<std::decay_t<decltype(value)>>{}(value);
+    };
+
+    combine(static_cast<int>(options.style));
+    combine(options.grid);
+    combine(options.gridColor);
+    combine(options.brightness);
+    combine(options.height);
+    combine(options.scaleFactor);
+    combine(options.ambientLight);
+    combine(options.lightSourceX);
+    combine(options.lightSourceY);
+    combine(options.minimumArea);
+
+    return hash | 1;
 }
 
-// I learned this squarification style from the KDirStat executable.
-// It's the most complex one here but also the clearest, imho.
-//
-void CTreeMap::KDirStat_DrawChildren(std::vector<COLORREF>& bitmap, const Item* parent, const double* surface, const double h, DWORD /*flags*/)
+const std::vector<CTreeMap::LAYOUTITEM>& CTreeMap::GetLayout() const
 {
-    ASSERT(parent->TmiGetChildCount() > 0);
-
-    const CRect& rc = parent->TmiGetRectangle();
+    return m_Layout;
+}
 
-    std::vector<double> rows;     // Our rectangle is divided into rows, each of which gets this height (fraction of total height).
-    std::vector<int> childrenPerRow; // childrenPerRow[i] = # of children in rows[i]
+std::optional<CTreeMap::UPDATESTATS> CTreeMap::TakeLastUpdate()
+{
+    return std::exchange(m_LastUpdate, std::nullopt);
+}
 
-    std::vector<double> childWidth; // Widths of the children (fraction of row width).
-    childWidth.resize(parent->TmiGetChildCount());
+void CTreeMap::SetViewport(const Viewport& viewport)
+{
+    m_Viewport = viewport;
+}
 
-    const bool horizontalRows = KDirStat_ArrangeChildren(parent, childWidth, rows, childrenPerRow);
+CTreeMap::Viewport CTreeMap::GetViewport() const
+{
+    return m_Viewport;
+}
 
-    const int width  = horizontalRows ? rc.Width() : rc.Height();
-    const int height = horizontalRows ? rc.Height() : rc.Width();
-    ASSERT(width >= 0);
-    ASSERT(height >= 0);
+void CTreeMap::ZoomViewport(const CSize& size, const CPoint point, const double factor)
+{
+    CRect rc;
+    CRect visible;
+    CalculateViewport(size, rc, visible);
 
-    int c = 0;
-    double top = horizontalRows ? rc.top : rc.left;
-    for (std::size_t row = 0; row < rows.size(); row++)
-    {
-        const double fBottom = top + rows[row] * height;
-        int bottom           = static_cast<int>(fBottom);
-        if (row == rows.size() - 1)
-        {
-            bottom = horizontalRows ? rc.bottom : rc.right;
-        }
-        double left = horizontalRows ? rc.left : rc.top;
-        for (int i = 0; i < childrenPerRow[row]; i++, c++)
-        {
-            Item* child = parent->TmiGetChild(c);
-            ASSERT(childWidth[c] >= 0);
-            const double fRight = left + childWidth[c] * width;
-            int right           = static_cast<int>(fRight);
+    // The position below point, relative to the root rectangle
+    const double x = (visible.left + point.x + 0.5) / rc.Width();
+    const double y = (visible.top + point.y + 0.5) / rc.Height();
 
-            const bool lastChild = i == childrenPerRow[row] - 1 || childWidth[c + 1] == 0;
+    m_Viewport.magnification *= factor;
+    CalculateViewport(size, rc, visible);
 
-            if (lastChild)
-            {
-                right = horizontalRows ? rc.right : rc.bottom;
-            }
+    m_Viewport.centerX = x + (size.cx / 2.0 - point.x) / rc.Width();
+    m_Viewport.centerY = y + (size.cy / 2.0 - point.y) / rc.Height();
+    CalculateViewport(size, rc, visible);
+}
 
-            CRect rcChild;
-            if (horizontalRows)
-            {
-                rcChild.left   = static_cast<int>(left);
-                rcChild.right  = right;
-                rcChild.top    = static_cast<int>(top);
-                rcChild.bottom = bottom;
-            }
-            else
-            {
-                rcChild.left   = static_cast<int>(top);
-                rcChild.right  = bottom;
-                rcChild.top    = static_cast<int>(left);
-                rcChild.bottom = right;
-            }
+void CTreeMap::PanViewport(const CSize& size, const CSize offset)
+{
+    CRect rc;
+    CRect visible;
+    CalculateViewport(size, rc, visible);
 
-#ifdef _DEBUG
-            if(rcChild.Width() > 0 && rcChild.Height() > 0)
-            {
-                CRect test;
-                test.IntersectRect(parent->TmiGetRectangle(), rcChild);
-                ASSERT(test == rcChild);
-            }
-#endif
+    m_Viewport.centerX += static_cast<double>(offset.cx) / rc.Width();
+    m_Viewport.centerY += static_cast<double>(offset.cy) / rc.Height();
+    CalculateViewport(size, rc, visible);
+}
 
-            RecurseDrawGraph(bitmap, child, rcChild, false, surface, h * m_Options.scaleFactor, 0);
+CRect CTreeMap::GetVisibleRect() const
+{
+    return m_LayoutVisible;
+}
 
-            if (lastChild)
-            {
-                i++;
-                c++;
+void CTreeMap::CalculateViewport(const CSize& size, CRect& rc, CRect& visible)
+{
+    const int extent = max(max(size.cx, size.cy), 1);
+    m_Viewport.magnification = std::clamp(m_Viewport.magnification, 1.0, max(1.0, static_cast<double>(MAX_LAYOUT_EXTENT) / extent));
 
-                if (i < childrenPerRow[row])
-                {
-                    parent->TmiGetChild(c)->TmiSetRectangle(CRect(-1, -1, -1, -1));
-                }
+    rc = CRect(0, 0,
+        static_cast<int>(size.cx * m_Viewport.magnification),
+        static_cast<int>(size.cy * m_Viewport.magnification));
 
-                c += childrenPerRow[row] - i;
-                break;
-            }
+    // The visible part is kept inside the root rectangle
+    const int left = std::clamp(static_cast<int>(m_Viewport.centerX * rc.Width() - size.cx / 2.0), 0, max(rc.Width() - size.cx, 0));
+    const int top  = std::clamp(static_cast<int>(m_Viewport.centerY * rc.Height() - size.cy / 2.0), 0, max(rc.Height() - size.cy, 0));
+    visible = CRect(CPoint(left, top), size);
 
-            left = fRight;
-        }
-        // This asserts due to rounding error: ASSERT(left == (horizontalRows ? rc.right : rc.bottom));
-        top = fBottom;
+    if (rc.Width() > 0 && rc.Height() > 0)
+    {
+        m_Viewport.centerX = (left + size.cx / 2.0) / rc.Width();
+        m_Viewport.centerY = (top + size.cy / 2.0) / rc.Height();
     }
-    // This asserts due to rounding error: ASSERT(top == (horizontalRows ? rc.bottom : rc.right));
 }
 
-// return: whether the rows are horizontal.
-//
-bool CTreeMap::KDirStat_ArrangeChildren(
-    const Item* parent,
-    std::vector<double>& childWidth,
-    std::vector<double>& rows,
-    std::vector<int>& childrenPerRow
-)
+const std::vector<CRect>& CTreeMap::GetGroupRectangles(const void* group) const
 {
-    ASSERT(!parent->TmiIsLeaf());
-    ASSERT(parent->TmiGetChildCount() > 0);
+    static const std::vector<CRect> none;
+    const auto rectangles = m_GroupRectangles.find(group);
+    return rectangles != m_GroupRectangles.end() ? rectangles->second : none;
+}
 
-    if (parent->TmiGetSize() == 0)
+CRect CTreeMap::GetDrawnRectangle(const std::vector<const Item*>& path) const
+{
+    if (m_Layout.empty() || path.empty() || m_Layout[0].item != path[0])
     {
-        rows.emplace_back(1.0);
-        childrenPerRow.emplace_back(parent->TmiGetChildCount());
-        for (int i = 0; i < parent->TmiGetChildCount(); i++)
-        {
-            childWidth[i] = 1.0 / parent->TmiGetChildCount();
-        }
-        return true;
+        return CRect();
     }
 
-    auto const& parentRect = parent->TmiGetRectangle();
-    const bool horizontalRows = parentRect.Width() >= parentRect.Height();
-
-
-    double width = 1.0;
-    if (horizontalRows)
+    // Descend along the path through the children of the entries, until
+    // an entry is reached whose descendants have not been laid out
+    int index = 0;
+    for (std::size_t i = 1; i < path.size() && m_Layout[index].leaf == nullptr && m_Layout[index].next > index + 1; i++)
     {
-        if (parentRect.Height() > 0)
+        int child = index + 1;
+        while (child < m_Layout[index].next && m_Layout[child].item != path[i])
         {
-            width = static_cast<double>(parentRect.Width()) / parentRect.Height();
+            child = m_Layout[child].next;
         }
-    }
-    else
-    {
-        if (parentRect.Width() > 0)
+        if (child >= m_Layout[index].next)
         {
-            width = static_cast<double>(parentRect.Height()) / parentRect.Width();
+            // Outside the visible part
+            return CRect();
         }
+        index = child;
     }
-
-    int nextChild = 0;
-    while (nextChild < parent->TmiGetChildCount())
-    {
-        int childrenUsed = 0;
-        rows.emplace_back(KDirStat_CalculateNextRow(parent, nextChild, width, childrenUsed, childWidth));
-        childrenPerRow.emplace_back(childrenUsed);
-        nextChild += childrenUsed;
-    }
-
-    return horizontalRows;
+    return m_Layout[index].rc;
 }
 
-double CTreeMap::KDirStat_CalculateNextRow(const Item* parent, const int nextChild, const double width, int& childrenUsed, std::vector<double>& childWidth)
+CTreeMap::Item* CTreeMap::FindItemByPoint(CPoint point) const
 {
-    static constexpr double _minProportion = 0.4;
-    ASSERT(_minProportion < 1.);
-
-    ASSERT(nextChild < parent->TmiGetChildCount());
-    ASSERT(width >= 1.0);
-
-    const double mySize = static_cast<double>(parent->TmiGetSize());
-    ASSERT(mySize > 0);
-    ULONGLONG sizeUsed = 0;
-    double rowHeight   = 0;
+    point += m_LayoutVisible.TopLeft();
+    if (m_Layout.empty() || !m_Layout[0].rc.PtInRect(point))
+    {
+        // The only case that this function returns NULL is that
+        // point is not inside the rectangle of the root.
+        //
+        // Take notice of
+        // (a) the very right an bottom lines, which can be "grid" and
+        //     are not covered by the root rectangle,
+        // (b) the fact, that WM_MOUSEMOVEs can occur after WM_SIZE but
+        //     before WM_PAINT.
+        //
+        return nullptr;
+    }
 
-    int i = 0;
-    for (i = nextChild; i < parent->TmiGetChildCount(); i++)
+    // Usually one of the drawn rectangles of the cell contains the point
+    if (const int cell = GetIndexCell(point); cell >= 0)
     {
-        const ULONGLONG childSize = parent->TmiGetChild(i)->TmiGetSize();
-        if (childSize == 0)
+        for (int i = m_IndexCells[cell]; i < m_IndexCells[cell + 1]; i++)
         {
-            ASSERT(i > nextChild); // first child has size > 0
-            break;
+            const LAYOUTITEM& entry = m_Layout[m_IndexEntries[i]];
+            if (entry.rc.PtInRect(point))
+            {
+                return entry.item;
+            }
         }
+    }
 
-        sizeUsed += childSize;
-        const double virtualRowHeight = sizeUsed / mySize;
-        ASSERT(virtualRowHeight > 0);
-        ASSERT(virtualRowHeight <= 1);
-
-        // Rectangle(mySize)    = width * 1.0
-        // Rectangle(childSize) = childWidth * virtualRowHeight
-        // Rectangle(childSize) = childSize / mySize * width
-
-        const double childWidth_ = childSize / mySize * width / virtualRowHeight;
-
-        if (childWidth_ / virtualRowHeight < _minProportion)
+    // Otherwise the point is in a part of an item not covered by its children.
+    // Descend into the child containing the point; siblings which
+    // don't contain it are skipped together with their subtrees.
+    int found = 0;
+    for (int i = 1; i < m_Layout[found].next;)
+    {
+        if (m_Layout[i].rc.PtInRect(point))
         {
-            ASSERT(i > nextChild); // because width >= 1 and _minProportion < 1.
-            // For the first child we have:
-            // childWidth / rowHeight
-            // = childSize / mySize * width / rowHeight / rowHeight
-            // = childSize * width / sizeUsed / sizeUsed * mySize
-            // > childSize * mySize / sizeUsed / sizeUsed
-            // > childSize * childSize / childSize / childSize
-            // = 1 > _minProportion.
-            break;
+            found = i++;
+        }
+        else
+        {
+            i = m_Layout[i].next;
         }
-        rowHeight = virtualRowHeight;
     }
-    ASSERT(i > nextChild);
 
-    // Now i-1 is the last child used
-    // and rowHeight is the height of the row.
+    return m_Layout[found].item;
+}
 
-    // We add the rest of the children, if their size is 0.
-    while (i < parent->TmiGetChildCount() && parent->TmiGetChild(i)->TmiGetSize() == 0)
+std::vector<CTreeMap::Item*> CTreeMap::FindItemsInRectangle(CRect rc) const
+{
+    std::vector<Item*> items;
+    if (m_IndexCells.empty())
     {
-        i++;
+        return items;
     }
 
-    childrenUsed = i - nextChild;
+    rc.OffsetRect(m_LayoutVisible.TopLeft());
+    rc.NormalizeRect();
 
-    // Now as we know the rowHeight, we compute the widths of our children.
-    for (i = 0; i < childrenUsed; i++)
+    const CRect cells = GetIndexCells(rc);
+    std::vector<int> entries;
+    for (int y = cells.top; y < cells.bottom; y++)
     {
-        // Rectangle(1.0 * 1.0) = mySize
-        const double rowSize   = mySize * rowHeight;
-        const double childSize = static_cast<double>(parent->TmiGetChild(nextChild + i)->TmiGetSize());
-        const double cw        = childSize / rowSize;
-        ASSERT(cw >= 0);
-        childWidth[nextChild + i] = cw;
+        for (int x = cells.left; x < cells.right; x++)
+        {
+            const int cell = y * m_IndexSize.cx + x;
+            for (int i = m_IndexCells[cell]; i < m_IndexCells[cell + 1]; i++)
+            {
+                CRect intersection;
+                if (intersection.IntersectRect(m_Layout[m_IndexEntries[i]].rc, rc))
+                {
+                    entries.emplace_back(m_IndexEntries[i]);
+                }
+            }
+        }
     }
 
-    return rowHeight;
+    // Rectangles which span several cells are found more than once
+    std::ranges::sort(entries);
+    const auto [first, last] = std::ranges::unique(entries);
+    entries.erase(first, last);
+
+    items.reserve(entries.size());
+    for (const int entry : entries)
+    {
+        items.emplace_back(m_Layout[entry].item);
+    }
+    return items;
 }
 
-// The classical squarification method.
-//
-void CTreeMap::SequoiaView_DrawChildren(std::vector<COLORREF>& bitmap, const Item* parent, const double* surface, const double h, DWORD /*flags*/)
+void CTreeMap::DrawColorPreview(CDC* pdc, const CRect& rc, const COLORREF color, const Options* options)
 {
-    // Rest rectangle to fill
-    CRect remaining(parent->TmiGetRectangle());
-
-    ASSERT(remaining.Width() > 0);
-    ASSERT(remaining.Height() > 0);
+    if (options != nullptr)
+    {
+        SetOptions(options);
+    }
 
-    // Size of rest rectangle
-    ULONGLONG remainingSize = parent->TmiGetSize();
-    ASSERT(remainingSize > 0);
+    double surface[4] = {0, 0, 0, 0};
+    AddRidge(rc, surface, m_Options.height * m_Options.scaleFactor);
 
-    // Scale factor
-    const double sizePerSquarePixel = static_cast<double>(parent->TmiGetSize()) / remaining.Width() / remaining.Height();
+    m_RenderArea = CRect(CPoint(0, 0), rc.Size());
 
-    // First child for next row
-    int head = 0;
+    // Create a temporary CDC that represents only the tree map
+    CDC dcTreeView;
+    VERIFY(dcTreeView.CreateCompatibleDC(pdc));
 
-    // At least one child left
-    while (head < parent->TmiGetChildCount())
-    {
-        ASSERT(remaining.Width() > 0);
-        ASSERT(remaining.Height() > 0);
+    // This bitmap will be blitted onto the temporary DC
+    CBitmap bmp;
 
-        // How we divide the remaining rectangle
-        const bool horizontal = remaining.Width() >= remaining.Height();
+    // That bitmap in turn will be created from this array
+    std::vector<COLORREF> bitmapBits;
+    bitmapBits.resize(rc.Width() * rc.Height());
 
-        // Height of the new row
-        const int height = horizontal ? remaining.Height() : remaining.Width();
+    // Recursively draw the tree graph
+    RenderRectangle(bitmapBits, CRect(0, 0, rc.Width(), rc.Height()), surface, color);
 
-        // Square of height in size scale for ratio formula
-        const double hh = height * height * sizePerSquarePixel;
-        ASSERT(hh > 0);
+    // Fill the bitmap with the array
+    VERIFY(bmp.CreateBitmap(rc.Width(), rc.Height(), 1, 32, bitmapBits.data()));
 
-        // Row will be made up of child(rowBegin)...child(rowEnd - 1)
-        const int rowBegin = head;
-        int rowEnd         = head;
+    // Render bitmap to the temporary CDC
+    dcTreeView.SelectObject(&bmp);
 
-        // Worst ratio so far
-        double worst = DBL_MAX;
+    // And lastly, draw the temporary CDC to the real one
+    VERIFY(pdc->BitBlt(rc.TopLeft().x, rc.TopLeft().y, rc.Width(), rc.Height(), &dcTreeView, 0, 0, SRCCOPY));
 
-        // Maximum size of children in row
-        const ULONGLONG rmax = parent->TmiGetChild(rowBegin)->TmiGetSize();
+    if (m_Options.grid)
+    {
+        CPen pen(PS_SOLID, 1, m_Options.gridColor);
+        CSelectObject sopen(pdc, &pen);
+        CSelectStockObject sobrush(pdc, NULL_BRUSH);
+        VERIFY(pdc->Rectangle(rc));
+    }
 
-        // Sum of sizes of children in row
-        ULONGLONG sum = 0;
+    // Free memory
+    VERIFY(bmp.DeleteObject());
+    VERIFY(dcTreeView.DeleteDC());
+}
 
-        // This condition will hold at least once.
-        while (rowEnd < parent->TmiGetChildCount())
-        {
-            // We check a virtual row made up of child(rowBegin)...child(rowEnd) here.
+// The spatial index is a uniform grid over the visible part of the layout.
+// Each cell lists the entries without children in the layout which overlap
+// it; these are the drawn rectangles and cover the treemap.
+//
+void CTreeMap::BuildIndex()
+{
+    m_IndexCells.clear();
+    m_IndexEntries.clear();
+    if (m_Layout.empty())
+    {
+        return;
+    }
 
-            // Minimum size of child in virtual row
-            const ULONGLONG rmin = parent->TmiGetChild(rowEnd)->TmiGetSize();
+    m_IndexSize = CSize(
+        (m_LayoutVisible.Width() + INDEX_CELL - 1) / INDEX_CELL,
+        (m_LayoutVisible.Height() + INDEX_CELL - 1) / INDEX_CELL);
+    m_IndexCells.assign(static_cast<std::size_t>(m_IndexSize.cx) * m_IndexSize.cy + 1, 0);
 
-            // If sizes of the rest of the children is zero, we add all of them
-            if (rmin == 0)
+    // Count the entries of each cell first, so that all cells
+    // can share a single array
+    const auto forEachCell = [this](const auto& function)
+    {
+        for (int i = 0; i < static_cast<int>(m_Layout.size()); i++)
+        {
+            if (m_Layout[i].next != i + 1 || m_Layout[i].rc.IsRectEmpty())
             {
-                rowEnd = parent->TmiGetChildCount();
-                break;
+                continue;
             }
 
-            // Calculate the worst ratio in virtual row.
-            // Formula taken from the "Squarified Treemaps" paper.
-            // (https://www.win.tue.nl/~vanwijk/)
+            const CRect cells = GetIndexCells(m_Layout[i].rc);
+            for (int y = cells.top; y < cells.bottom; y++)
+            {
+                for (int x = cells.left; x < cells.right; x++)
+                {
+                    function(y * m_IndexSize.cx + x, i);
+                }
+            }
+        }
+    };
 
-            const double ss     = (static_cast<double>(sum) + rmin) * (static_cast<double>(sum) + rmin);
-            const double ratio1 = hh * rmax / ss;
-            const double ratio2 = ss / hh / rmin;
+    forEachCell([this](const int cell, int) { m_IndexCells[cell + 1]++; });
+    for (std::size_t cell = 1; cell < m_IndexCells.size(); cell++)
+    {
+        m_IndexCells[cell] += m_IndexCells[cell - 1];
+    }
 
-            const double nextWorst = max(ratio1, ratio2);
+    m_IndexEntries.resize(m_IndexCells.back());
+    std::vector fill(m_IndexCells.begin(), m_IndexCells.end() - 1);
+    forEachCell([this, &fill](const int cell, const int entry) { m_IndexEntries[fill[cell]++] = entry; });
+}
 
-            // Will the ratio get worse?
-            if (nextWorst > worst)
-            {
-                // Yes. Don't take the virtual row, but the
-                // real row (child(rowBegin)..child(rowEnd - 1))
-                // made so far.
-                break;
-            }
+CRect CTreeMap::GetIndexCells(const CRect& rc) const
+{
+    CRect visible;
+    if (!visible.IntersectRect(rc, m_LayoutVisible))
+    {
+        return CRect();
+    }
 
-            // Here we have decided to add child(rowEnd) to the row.
-            sum += rmin;
-            rowEnd++;
+    return CRect(
+        (visible.left - m_LayoutVisible.left) / INDEX_CELL,
+        (visible.top - m_LayoutVisible.top) / INDEX_CELL,
+        (visible.right - m_LayoutVisible.left + INDEX_CELL - 1) / INDEX_CELL,
+        (visible.bottom - m_LayoutVisible.top + INDEX_CELL - 1) / INDEX_CELL);
+}
 
-            worst = nextWorst;
-        }
+int CTreeMap::GetIndexCell(const CPoint& point) const
+{
+    if (m_IndexCells.empty() || !m_LayoutVisible.PtInRect(point))
+    {
+        return -1;
+    }
 
-        // Row will be made up of child(rowBegin)...child(rowEnd - 1).
-        // sum is the size of the row.
+    return (point.y - m_LayoutVisible.top) / INDEX_CELL * m_IndexSize.cx + (point.x - m_LayoutVisible.left) / INDEX_CELL;
+}
 
-        // As the size of parent is greater than zero, the size of
-        // the first child must have been greater than zero, too.
-        ASSERT(sum > 0);
+void CTreeMap::Layout(Item* root, const CRect& rc, const CRect& visible)
+{
+    m_Layout.clear();
+    m_GroupRectangles.clear();
+    m_LayoutRoot  = root;
+    m_LayoutRect  = rc;
+    m_LayoutVisible = visible;
+    m_LayoutStyle = m_Options.style;
+    m_LayoutGrid  = m_Options.grid;
+    m_LayoutMinimumArea = m_Options.minimumArea;
+    m_PendingPath.clear();
+
+    (this->*m_RecurseLayout)(root, rc, -1);
+    ComputeSurfaces(0, m_Layout.size());
+    BuildIndex();
+}
 
-        // Width of row
-        int width = horizontal ? remaining.Width() : remaining.Height();
-        ASSERT(width > 0);
+int CTreeMap::UpdateLayout(const std::vector<Item*>& path, std::vector<int>& dirty)
+{
+    if (m_Layout.empty() || m_Layout[0].item != path[0] || path[0]->TmiGetSize() == 0)
+    {
+        return -1;
+    }
 
-        if (sum < remainingSize)
-            width = static_cast<int>(static_cast<double>(sum) / remainingSize * width);
-        // else: use up the whole width
-        // width may be 0 here.
+    std::vector<LAYOUTITEM> old;
+    std::swap(old, m_Layout);
+    m_Layout.reserve(old.size());
+    m_GroupRectangles.clear();
+
+    // Lays out the entry old[index] on the path into rc again. Its children are laid out
+    // one level deep first. Those off the path whose rectangle is unchanged, as are the
+    // ones of the entry and all its ancestors (keep), take over their old subtree with
+    // its surfaces. All others are laid out anew and appended to dirty.
+    int kept = 0;
+    std::vector<LAYOUTITEM> probe;
+    std::unordered_map<const Item*, int> previous;
+    const auto update = [&](const auto& self, const int index, const CRect& rc, const int parent,
+        const std::size_t level, const bool keep) -> void
+    {
+        ProbeChildren(old[index].item, rc, probe);
+
+        const int entry = static_cast<int>(m_Layout.size());
+        LAYOUTITEM& e = m_Layout.emplace_back(probe[0]);
+        e.depth = parent < 0 ? 0 : m_Layout[parent].depth + 1;
+        e.parent = parent;
+        e.next = entry + 1;
+        ComputeSurfaces(entry, entry + 1);
+        if (e.leaf != nullptr || probe.size() == 1)
+        {
+            dirty.push_back(entry);
+            return;
+        }
 
-        // Build the rectangles of children.
-        CRect rc;
-        double fBegin;
-        if (horizontal)
+        // The probe and the lookup are reused by the recursion
+        const std::vector children(probe.begin() + 1, probe.end());
+        previous.clear();
+        for (int child = index + 1; child < old[index].next; child = old[child].next)
         {
-            rc.left  = remaining.left;
-            rc.right = remaining.left + width;
-            fBegin   = remaining.top;
+            previous.emplace(old[child].item, child);
         }
-        else
+        std::vector<int> found;
+        found.reserve(children.size());
+        for (const LAYOUTITEM& child : children)
         {
-            rc.top    = remaining.top;
-            rc.bottom = remaining.top + width;
-            fBegin    = remaining.left;
+            const auto it = previous.find(child.item);
+            found.push_back(it != previous.end() ? it->second : -1);
         }
 
-        // Now put the children into their places
-        for (int i = rowBegin; i < rowEnd; i++)
+        const bool same = keep && rc == old[index].rc;
+        for (std::size_t c = 0; c < children.size(); c++)
         {
-            const int begin       = static_cast<int>(fBegin);
-            const double fraction = static_cast<double>(parent->TmiGetChild(i)->TmiGetSize()) / sum;
-            const double fEnd     = fBegin + fraction * height;
-            int end               = static_cast<int>(fEnd);
-
-            const bool lastChild = i == rowEnd - 1 || parent->TmiGetChild(i + 1)->TmiGetSize() == 0;
-
-            if (lastChild)
+            const LAYOUTITEM& child = children[c];
+            const int before = found[c];
+            if (before >= 0 && level + 1 < path.size() && child.item == path[level + 1])
             {
-                // Use up the whole height
-                end = horizontal ? remaining.top + height : remaining.left + height;
+                self(self, before, child.rc, entry, level + 1, same);
             }
-
-            if (horizontal)
+            else if (before >= 0 && same && old[before].rc == child.rc)
             {
-                rc.top    = begin;
-                rc.bottom = end;
+                const int delta = static_cast<int>(m_Layout.size()) - before;
+                for (int i = before; i < old[before].next; i++)
+                {
+                    LAYOUTITEM& copy = m_Layout.emplace_back(old[i]);
+                    copy.parent = i == before ? entry : copy.parent + delta;
+                    copy.next += delta;
+                    if (const void* group = copy.leaf != nullptr ? copy.leaf->TmiGetGroup() : nullptr; group != nullptr)
+                    {
+                        m_GroupRectangles[group].emplace_back(copy.rc);
+                    }
+                }
+                kept += old[before].next - before;
             }
             else
             {
-                rc.left  = begin;
-                rc.right = end;
+                const int first = static_cast<int>(m_Layout.size());
+                (this->*m_RecurseLayout)(child.item, child.rc, entry);
+                if (static_cast<int>(m_Layout.size()) > first)
+                {
+                    ComputeSurfaces(first, m_Layout.size());
+                    dirty.push_back(first);
+                }
             }
+        }
+        m_Layout[entry].next = static_cast<int>(m_Layout.size());
+    };
 
-            ASSERT(rc.left <= rc.right);
-            ASSERT(rc.top <= rc.bottom);
+    update(update, 0, old[0].rc, -1, 0, true);
 
-            ASSERT(rc.left >= remaining.left);
-            ASSERT(rc.right <= remaining.right);
-            ASSERT(rc.top >= remaining.top);
-            ASSERT(rc.bottom <= remaining.bottom);
+    BuildIndex();
+    return kept;
+}
 
-            RecurseDrawGraph(bitmap, parent->TmiGetChild(i), rc, false, surface, h * m_Options.scaleFactor, 0);
+void CTreeMap::ProbeChildren(Item* item, const CRect& rc, std::vector<LAYOUTITEM>& probe)
+{
+    probe.clear();
+    std::swap(m_Layout, probe);
+    m_MaxLayoutDepth = 1;
+    (this->*m_RecurseLayout)(item, rc, -1);
+    m_MaxLayoutDepth = INT_MAX;
+    std::swap(m_Layout, probe);
+}
 
-            if (lastChild)
-                break;
+void CTreeMap::ComputeSurfaces(const std::size_t first, const std::size_t last)
+{
+    m_SurfaceHeight      = m_Options.height;
+    m_SurfaceScaleFactor = m_Options.scaleFactor;
 
-            fBegin = fEnd;
-        }
+    const int gridWidth = m_LayoutGrid ? 1 : 0;
 
-        // Put the next row into the rest of the rectangle
-        if (horizontal)
+    // Parents precede their children, so one pass suffices. The ridge
+    // height only depends on the depth of an entry.
+    std::vector heights{ m_Options.height };
+    for (std::size_t i = first; i < last; i++)
+    {
+        LAYOUTITEM& entry = m_Layout[i];
+        if (entry.parent < 0)
         {
-            remaining.left += width;
+            std::ranges::fill(entry.surface, 0.0);
+            continue;
         }
-        else
+
+        while (heights.size() <= static_cast<std::size_t>(entry.depth))
         {
-            remaining.top += width;
+            heights.push_back(heights.back() * m_Options.scaleFactor);
         }
 
-        remainingSize -= sum;
-
-        ASSERT(remaining.left <= remaining.right);
-        ASSERT(remaining.top <= remaining.bottom);
-
-        ASSERT(remainingSize >= 0);
+        std::ranges::copy(m_Layout[entry.parent].surface, entry.surface);
 
-        head += rowEnd - rowBegin;
-
-        if (remaining.Width() <= 0 || remaining.Height() <= 0)
+        if (entry.rc.Width() > gridWidth && entry.rc.Height() > gridWidth)
         {
-            if (head < parent->TmiGetChildCount())
-            {
-                parent->TmiGetChild(head)->TmiSetRectangle(CRect(-1, -1, -1, -1));
-            }
+            AddRidge(entry.rc, entry.surface, heights[entry.depth]);
+        }
+    }
+}
 
-            break;
+void CTreeMap::RenderLayout(std::vector<COLORREF>& bitmap, const int first, const int last)
+{
+    const auto renderEntry = [&](const LAYOUTITEM& entry)
+    {
+        if (entry.leaf != nullptr)
+        {
+            RenderLeaf(bitmap, entry);
         }
+    };
+
+    // Leaves cover disjoint rectangles, so they can be rendered
+    // concurrently with the same result as in sequence
+    CRect rc;
+    rc.IntersectRect(m_Layout[first].rc, m_RenderArea);
+    if (m_ParallelRendering && std::thread::hardware_concurrency() > 1 && rc.Width() * rc.Height() >= 256 * 1024)
+    {
+        std::for_each(std::execution::par, m_Layout.begin() + first, m_Layout.begin() + last, renderEntry);
+    }
+    else
+    {
+        std::for_each(m_Layout.begin() + first, m_Layout.begin() + last, renderEntry);
     }
-    ASSERT(remainingSize == 0);
-    ASSERT(remaining.left == remaining.right || remaining.top == remaining.bottom);
 }
 
+// The layout for items of other classes is instantiated along with their access policy
+template void CTreeMap::RecurseLayout<CTreeMap::ItemAccess>(Item* item, const CRect& rc, int parent);
+
 bool CTreeMap::IsCushionShading() const
 {
     return m_Options.ambientLight < 1.0
@@ -989,9 +1357,9 @@ bool CTreeMap::IsCushionShading() const
     && m_Options.scaleFactor > 0.0;
 }
 
-void CTreeMap::RenderLeaf(std::vector<COLORREF>& bitmap, const Item* item, const double* surface)
+void CTreeMap::RenderLeaf(std::vector<COLORREF>& bitmap, const LAYOUTITEM& entry)
 {
-    CRect rc = item->TmiGetRectangle();
+    CRect rc = entry.rc;
 
     if (m_Options.grid)
     {
@@ -1003,7 +1371,14 @@ void CTreeMap::RenderLeaf(std::vector<COLORREF>& bitmap, const Item* item, const
         }
     }
 
-    RenderRectangle(bitmap, rc, surface, item->TmiGetGraphColor());
+    // Only the part inside the bitmap is rendered
+    CRect visible;
+    if (!visible.IntersectRect(rc, m_RenderArea))
+    {
+        return;
+    }
+
+    RenderRectangle(bitmap, visible, entry.surface, entry.leaf->TmiGetGraphColor());
 }
 
 void CTreeMap::RenderRectangle(std::vector<COLORREF>& bitmap, const CRect& rc, const double* surface, DWORD color)
@@ -1057,7 +1432,7 @@ void CTreeMap::DrawSolidRect(std::vector<COLORREF>& bitmap, const CRect& rc, con
     {
         for (int ix = rc.left; ix < rc.right; ix++)
         {
-            bitmap[ix + iy * m_RenderArea.Width()] = BGR(blue, green, red);
+            bitmap[(ix - m_RenderArea.left) + (iy - m_RenderArea.top) * m_RenderArea.Width()] = BGR(blue, green, red);
         }
     }
 }
@@ -1070,51 +1445,72 @@ void CTreeMap::DrawCushion(std::vector<COLORREF>& bitmap, const CRect& rc, const
     // Derived parameters
     const double Is = 1 - Ia; // shading
 
-    const double colR = RGB_GET_RVALUE(col);
-    const double colG = RGB_GET_GVALUE(col);
-    const double colB = RGB_GET_BVALUE(col);
-
+    CUSHIONROW row;
+    row.s0     = surface[0];
+    row.s2     = surface[2];
+    row.lx     = m_Lx;
+    row.ly     = m_Ly;
+    row.lz     = m_Lz;
+    row.ia     = Ia;
+    row.is     = Is;
+    row.factor = brightness / PALETTE_BRIGHTNESS;
+    row.colR   = RGB_GET_RVALUE(col);
+    row.colG   = RGB_GET_GVALUE(col);
+    row.colB   = RGB_GET_BVALUE(col);
+    row.left   = rc.left;
+
+    // The vertical part of the normal is constant along a row, so
+    // whole rows are handed to the (possibly vectorized) kernel.
     for (int iy = rc.top; iy < rc.bottom; iy++)
-        for (int ix = rc.left; ix < rc.right; ix++)
-        {
-            const double nx = -(2 * surface[0] * (ix + 0.5) + surface[2]);
-            const double ny = -(2 * surface[1] * (iy + 0.5) + surface[3]);
-            double cosa     = (nx * m_Lx + ny * m_Ly + m_Lz) / sqrt(nx * nx + ny * ny + 1.0);
-            if (cosa > 1.0)
-            {
-                cosa = 1.0;
-            }
-
-            double pixel = Is * cosa;
-            if (pixel < 0)
-            {
-                pixel = 0;
-            }
-
-            pixel += Ia;
-            ASSERT(pixel <= 1.0);
-
-            // Now, pixel is the brightness of the pixel, 0...1.0.
-
-            // Apply contrast.
-            // Not implemented.
-            // Costs performance and nearly the same effect can be
-            // made width the m_Options->ambientLight parameter.
-            // pixel = pow(pixel, m_Options->contrast);
+    {
+        row.ny = -(2 * surface[1] * (iy + 0.5) + surface[3]);
+        ShadeCushionRow(&bitmap[(rc.left - m_RenderArea.left) + (iy - m_RenderArea.top) * m_RenderArea.Width()], rc.Width(), row);
+    }
+}
 
-            // Apply "brightness"
-            pixel *= brightness / PALETTE_BRIGHTNESS;
+std::vector<CTreeMap::KERNELTIMING> CTreeMap::MeasureCushionShading(const CSize& size, const int iterations)
+{
+    std::vector<std::pair<LPCWSTR, CushionRowKernel>> kernels = { { L"Scalar", ShadeCushionRowScalar } };
+    if (::IsProcessorFeaturePresent(PF_SSE4_1_INSTRUCTIONS_AVAILABLE)) kernels.emplace_back(L"SSE4.1", ShadeCushionRowSSE41);
+    if (::IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE)) kernels.emplace_back(L"AVX2", ShadeCushionRowAVX2);
 
-            // Make color value
-            int red   = static_cast<int>(colR * pixel);
-            int green = static_cast<int>(colG * pixel);
-            int blue  = static_cast<int>(colB * pixel);
+    // A single cushion covering the whole area in the colors of the palette
+    const CRect rc(CPoint(0, 0), size);
+    double surface[4] = { 0, 0, 0, 0 };
+    AddRidge(rc, surface, m_Options.height * m_Options.scaleFactor);
+    std::vector<COLORREF> palette;
+    GetDefaultPalette(palette);
+    m_RenderArea = rc;
 
-            CColorSpace::NormalizeColor(red, green, blue);
+    // DrawCushion() is measured as it is, with each kernel in turn
+    const CushionRowKernel selected = ShadeCushionRow;
+    std::vector<COLORREF> reference;
+    std::vector<KERNELTIMING> timings;
+    for (const auto& [name, kernel] : kernels)
+    {
+        ShadeCushionRow = kernel;
+        std::vector<COLORREF> bitmap(static_cast<std::size_t>(size.cx) * size.cy);
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            DrawCushion(bitmap, rc, surface, palette[i % palette.size()], m_Options.brightness);
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-            // ... and set!
-            bitmap[ix + iy * m_RenderArea.Width()] = BGR(blue, green, red);
+        if (reference.empty()) reference = bitmap;
+        int deviation = 0;
+        for (std::size_t i = 0; i < bitmap.size(); i++)
+        {
+            for (int shift = 0; shift < 24; shift += 8)
+            {
+                deviation = max(deviation, abs(static_cast<int>(bitmap[i] >> shift & 0xFF) - static_cast<int>(reference[i] >> shift & 0xFF)));
+            }
         }
+        timings.push_back({ name, static_cast<double>(size.cx) * size.cy * iterations / max(seconds, 1e-9), deviation });
+    }
+    ShadeCushionRow = selected;
+
+    return timings;
 }
 
 void CTreeMap::AddRidge(const CRect& rc, double* surface, const double h)
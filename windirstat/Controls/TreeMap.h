@@ -22,6 +22,10 @@
 #pragma once
 
 #include <algorithm>
+#include <functional>
+#include <list>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
 //
@@ -77,6 +81,10 @@ public:
         virtual int TmiGetChildCount() const = 0;
         virtual Item* TmiGetChild(int c) const = 0;
         virtual ULONGLONG TmiGetSize() const = 0;
+
+        // Leaves with the same group are indexed together during layout
+        // (see GetGroupRectangles()). nullptr means no group.
+        virtual const void* TmiGetGroup() const { return nullptr; }
     };
 
     //
@@ -84,8 +92,9 @@ public:
     //
     enum STYLE
     {
-        KDirStatStyle,   // Children are layed out in rows. Similar to the style used by KDirStat.
-        SequoiaViewStyle // The 'classical' squarification as described in at https://www.win.tue.nl/~vanwijk/.
+        KDirStatStyle,    // Children are layed out in rows. Similar to the style used by KDirStat.
+        SequoiaViewStyle, // The 'classical' squarification as described in at https://www.win.tue.nl/~vanwijk/.
+        StripStyle        // Children are layed out in strips in a stable order (strip treemap).
     };
 
     //
@@ -102,6 +111,7 @@ public:
         double ambientLight; // 0..1.0   (default = 0.15)    Factor "Ia"
         double lightSourceX; // -4.0..+4.0 (default = -1.0), negative = left
         double lightSourceY; // -4.0..+4.0 (default = -1.0), negative = top
+        int minimumArea;     // Subtrees smaller than this (in pixels) are drawn as one cushion
 
         int GetBrightnessPercent() const
         {
@@ -180,6 +190,76 @@ public:
         }
     };
 
+    //
+    // Access policies for the layout, which is instantiated for each policy.
+    // The layout queries every child several times, so a policy can read the
+    // children and sizes of a known item type directly. ItemAccess goes
+    // through the virtual Item interface and works for all items.
+    // IsStripBefore() orders the children for StripStyle independently
+    // of their sizes, so that refreshes do not rearrange them.
+    //
+    struct ItemAccess
+    {
+        static bool IsLeaf(const Item* item) { return item->TmiIsLeaf(); }
+        static int GetChildCount(const Item* item) { return item->TmiGetChildCount(); }
+        static Item* GetChild(const Item* item, const int i) { return item->TmiGetChild(i); }
+        static ULONGLONG GetSize(const Item* item) { return item->TmiGetSize(); }
+        static void SetRectangle(Item* item, const CRect& rc) { item->TmiSetRectangle(rc); }
+        static bool IsStripBefore(const Item*, const Item*) { return false; } // Keeps the given order
+    };
+
+    //
+    // The part of the treemap which DrawTreeMap() draws. The treemap is laid
+    // out magnification times as large as the drawing area, which then shows
+    // the part around the center. The center is given relative to the root
+    // rectangle, so it does not depend on the size of the drawing area.
+    // Items outside that part are neither laid out nor rendered.
+    //
+    struct Viewport
+    {
+        double centerX = 0.5;
+        double centerY = 0.5;
+        double magnification = 1.0;
+    };
+
+    //
+    // One entry of the layout. The entries are stored in preorder, so
+    // the subtree of an entry is the range [index + 1, next).
+    //
+    struct LAYOUTITEM
+    {
+        Item* item;
+        Item* leaf;        // Leaf whose color fills rc, nullptr if the children are drawn
+        CRect rc;          // Same as item->TmiGetRectangle()
+        double surface[4]; // Cushion coefficients, including the own ridge
+        int depth;         // 0 for the root
+        int parent;        // Index of the parent entry, -1 for the root
+        int next;          // Index of the first entry after the subtree
+    };
+
+    //
+    // Throughput of one of the cushion kernels, see MeasureCushionShading()
+    //
+    struct KERNELTIMING
+    {
+        LPCWSTR name;
+        double pixelsPerSecond;
+        int maxDeviation; // Largest difference of a color channel from the scalar kernel
+    };
+
+    //
+    // Cost of a change applied by DrawTreeMap(), see TakeLastUpdate()
+    //
+    struct UPDATESTATS
+    {
+        LONGLONG pixels;      // Pixels rendered again
+        LONGLONG totalPixels;
+        int keptEntries;      // Entries kept from the previous layout
+        std::size_t entries;
+        double keptOverall;   // Percentage of the entries kept by all changes so far
+        double milliseconds;
+    };
+
     // Get a good palette of 13 colors (7 if system has 256 colors)
     static void GetDefaultPalette(std::vector<COLORREF>& palette);
 
@@ -196,58 +276,194 @@ public:
     void SetOptions(const Options* options);
     Options GetOptions() const;
 
+    // Lays out the items through Access instead of ItemAccess. All items
+    // passed to this instance must then be of the type Access expects.
+    template <class Access> void SetItemAccess()
+    {
+        m_RecurseLayout = &CTreeMap::RecurseLayout<Access>;
+    }
+
+    // Renders the leaves of large bitmaps on all processors (the default)
+    // or on the calling thread only, which gives the same bitmap
+    void SetParallelRendering(const bool parallel)
+    {
+        m_ParallelRendering = parallel;
+    }
+
+    // Alter the viewport of DrawTreeMap()
+    void SetViewport(const Viewport& viewport);
+    Viewport GetViewport() const;
+
+    // Magnifies the viewport by factor, so that the part of the treemap below
+    // point (in a drawing area of the given size) stays in place
+    void ZoomViewport(const CSize& size, CPoint point, double factor);
+
+    // Moves the viewport by offset pixels of a drawing area of the given size
+    void PanViewport(const CSize& size, CSize offset);
+
 #ifdef _DEBUG
     // DEBUG function
     void RecurseCheckTree(const Item *item);
 #endif // _DEBUG
 
-    // Create and draw a treemap
+    // Create and draw a treemap. The layout of the previous call is reused
+    // if only options which affect the shading have changed. Layouts and
+    // renderings of roots drawn before are kept in a cache, so returning
+    // to them does not require a new layout. Only the part of the treemap
+    // given by the viewport is laid out and drawn.
     void DrawTreeMap(CDC* pdc, CRect rc, Item* root, const Options* options = nullptr);
 
+    // Renders a treemap of the given size into bitmap (top-down, one
+    // COLORREF in BGR order per pixel) without a device context. Returns
+    // false, if root is empty and the bitmap only cleared.
+    bool RenderTreeMap(std::vector<COLORREF>& bitmap, const CSize& size, Item* root, const Options* options = nullptr);
+
     // Same as above but double buffered
     void DrawTreeMapDoubleBuffered(CDC* pdc, const CRect& rc, Item* root, const Options* options = nullptr);
 
+    // Only lays out the treemap of root for a drawing area of the given size
+    void LayoutTreeMap(Item* root, const CSize& size);
+
+    // Forces the next DrawTreeMap() to lay out the tree again. Must be
+    // called whenever the items or their sizes change.
+    void InvalidateLayout();
+
+    // Same as above, but only drops the layouts whose root is affected by a change
+    void InvalidateLayout(const std::function<bool(const Item* root)>& affected);
+
+    // Announces a change below the last item of path, which lists the items from
+    // the root of the current layout downwards. The next DrawTreeMap() then only
+    // lays out and renders the items along path and the subtrees which have moved.
+    // Cached layouts are dropped as with InvalidateLayout(affected).
+    void InvalidateSubtree(const std::vector<Item*>& path, const std::function<bool(const Item* root)>& affected);
+
+    // Returns and forgets the cost of the last change applied by DrawTreeMap()
+    // after InvalidateSubtree(). Empty if it had to lay out everything again.
+    std::optional<UPDATESTATS> TakeLastUpdate();
+
+    // Forces DrawTreeMap() to render again, e.g. because the colors of the items have changed
+    void InvalidateBitmaps();
+
+    // The layout of the last DrawTreeMap()
+    const std::vector<LAYOUTITEM>& GetLayout() const;
+
+    // The part of the layout drawn by the last DrawTreeMap(). Rectangles of
+    // the layout are relative to the drawing area after subtracting its top left.
+    CRect GetVisibleRect() const;
+
+    // The visible leaf rectangles of the last layout which belong to group
+    const std::vector<CRect>& GetGroupRectangles(const void* group) const;
+
+    // The rectangle drawn for the last item of path, which lists the items from the
+    // root of the last layout downwards: its own, or that of the subtree drawn as a
+    // single cushion containing it. Empty, if the item is not drawn, e.g. outside
+    // the visible part of a magnified treemap. Unlike TmiGetRectangle(), this never
+    // refers to an older layout.
+    CRect GetDrawnRectangle(const std::vector<const Item*>& path) const;
+
     // In the resulting treemap, find the item below a given coordinate.
     // Return value can be NULL, iff point is outside root rect.
-    Item* FindItemByPoint(Item* item, CPoint point);
+    Item* FindItemByPoint(CPoint point) const;
+
+    // Finds the items of all drawn rectangles which intersect rc
+    std::vector<Item*> FindItemsInRectangle(CRect rc) const;
 
     // Draws a sample rectangle in the given style (for color legend)
     void DrawColorPreview(CDC* pdc, const CRect& rc, COLORREF color, const Options* options = nullptr);
 
+    // Shades a cushion of the given size iterations times with each cushion
+    // kernel the processor supports, starting with the scalar one (for benchmarks)
+    std::vector<KERNELTIMING> MeasureCushionShading(const CSize& size, int iterations);
+
 protected:
-    // The recursive drawing function
-    void RecurseDrawGraph(
-        std::vector<COLORREF>& bitmap,
-        Item* item,
-        const CRect& rc,
-        bool asroot,
-        const double* psurface,
-        double h,
-        DWORD flags
-    );
-
-    // This function switches to KDirStat-, SequoiaView- or Simple_DrawChildren
-    void DrawChildren(
-        std::vector<COLORREF>& bitmap,
-        const Item* parent,
-        const double* surface,
-        double h,
-        DWORD flags
-    );
+    // A layout and its rendering, kept by DrawTreeMap() for a root shown before
+    struct CACHEENTRY
+    {
+        Item* root;
+        CRect rect;
+        STYLE style;
+        bool grid;
+        int minimumArea;
+        double surfaceHeight;
+        double surfaceScaleFactor;
+        std::vector<LAYOUTITEM> layout;
+        std::unordered_map<const void*, std::vector<CRect>> groupRectangles;
+        std::vector<COLORREF> bitmap;
+        std::size_t bitmapOptions;
+        std::size_t bytes;
+    };
+
+    // Whether m_Layout was made for root, rc and visible with the current options
+    bool IsLayoutCurrent(const Item* root, const CRect& rc, const CRect& visible) const;
+
+    // Moves the current layout and rendering to the front of m_Cache
+    void StoreInCache();
+
+    // Drops the current layout and rendering without caching them
+    void ClearLayout();
+
+    // Makes a cached layout for root and rc current, if there is one
+    bool RestoreFromCache(const Item* root, const CRect& rc);
+
+    // Identifies the options a bitmap was rendered with; never 0
+    static std::size_t HashOptions(const Options& options);
+
+    // Clamps m_Viewport for a drawing area of the given size and calculates
+    // the root rectangle and its visible part
+    void CalculateViewport(const CSize& size, CRect& rc, CRect& visible);
+
+    // Lays out and renders the visible part of the treemap of root into bitmap
+    bool RenderViewport(std::vector<COLORREF>& bitmap, Item* root, const CRect& rc, const CRect& visible);
+
+    // Builds the spatial index of the drawn rectangles in m_Layout
+    void BuildIndex();
+
+    // The range of index cells which overlap rc, or the cell which contains point (-1 if none)
+    CRect GetIndexCells(const CRect& rc) const;
+    int GetIndexCell(const CPoint& point) const;
+
+    // Lays out the visible part of the tree into m_Layout
+    void Layout(Item* root, const CRect& rc, const CRect& visible);
+
+    // Lays out the entries on path again and only those of their children which have moved.
+    // Appends the first index of every subtree laid out anew to dirty. Returns the number
+    // of entries kept from the previous layout, or -1 if not possible.
+    int UpdateLayout(const std::vector<Item*>& path, std::vector<int>& dirty);
+
+    // Lays out item and its children into probe without touching m_Layout
+    void ProbeChildren(Item* item, const CRect& rc, std::vector<LAYOUTITEM>& probe);
+
+    // The recursive layout function
+    template <class Access> void RecurseLayout(Item* item, const CRect& rc, int parent);
+
+    // The leaf whose color a subtree drawn as a single cushion takes
+    template <class Access> static Item* FindDominantLeaf(Item* item);
+
+    // This function switches to KDirStat- or SequoiaView_LayoutChildren
+    template <class Access> void LayoutChildren(int parent);
 
     // KDirStat-like squarification
-    void KDirStat_DrawChildren(std::vector<COLORREF>& bitmap, const Item* parent, const double* surface, double h, DWORD flags);
-    bool KDirStat_ArrangeChildren(const Item* parent, std::vector<double>& childWidth, std::vector<double>& rows, std::vector<int>& childrenPerRow);
-    double KDirStat_CalculateNextRow(const Item* parent, int nextChild, double width, int& childrenUsed, std::vector<double>& childWidth);
+    template <class Access> void KDirStat_LayoutChildren(int index);
+    template <class Access> bool KDirStat_ArrangeChildren(const Item* parent, const CRect& parentRect, double* childWidth, std::vector<double>& rows, std::vector<int>& childrenPerRow);
+    template <class Access> double KDirStat_CalculateNextRow(const Item* parent, int nextChild, double width, int& childrenUsed, double* childWidth);
 
     // Classical SequoiaView-like squarification
-    void SequoiaView_DrawChildren(std::vector<COLORREF>& bitmap, const Item* parent, const double* surface, double h, DWORD flags);
+    template <class Access> void SequoiaView_LayoutChildren(int index);
+
+    // Ordered strips, found in linear time with prefix sums
+    template <class Access> void Strip_LayoutChildren(int index);
+
+    // Calculates the cushion surfaces of the entries in the range [first, last) for the current height and scaleFactor
+    void ComputeSurfaces(std::size_t first, std::size_t last);
+
+    // Renders the leaves of the layout in the range [first, last)
+    void RenderLayout(std::vector<COLORREF>& bitmap, int first, int last);
 
     // Returns true, if height and scaleFactor are > 0 and ambientLight is < 1.0
     bool IsCushionShading() const;
 
     // Leaves space for grid and then calls RenderRectangle()
-    void RenderLeaf(std::vector<COLORREF>& bitmap, const Item* item, const double* surface);
+    void RenderLeaf(std::vector<COLORREF>& bitmap, const LAYOUTITEM& entry);
 
     // Either calls DrawCushion() or DrawSolidRect()
     void RenderRectangle(std::vector<COLORREF>& bitmap, const CRect& rc, const double* surface, DWORD color);
@@ -266,7 +482,44 @@ protected:
     static const Options _defaultOptionsOld;          // WinDirStat 1.0.1 default options
     static const COLORREF _defaultCushionColors[];    // Standard palette for WinDirStat
 
-    CRect m_RenderArea;
+    CRect m_RenderArea;                 // Part of the layout covered by the bitmap being rendered
+    std::vector<COLORREF> m_BitmapBits; // Framebuffer of DrawTreeMap(), kept between calls
+
+    std::vector<LAYOUTITEM> m_Layout;    // Result of the layout stage
+    std::unordered_map<const void*, std::vector<CRect>> m_GroupRectangles; // Visible leaves by TmiGetGroup()
+    Item* m_LayoutRoot = nullptr;        // Parameters m_Layout was made with
+    CRect m_LayoutRect;
+    CRect m_LayoutVisible;
+    STYLE m_LayoutStyle = KDirStatStyle;
+    bool m_LayoutGrid = false;
+    int m_LayoutMinimumArea = 0;
+    double m_SurfaceHeight = -1.0;       // Parameters the surfaces were computed with
+    double m_SurfaceScaleFactor = -1.0;
+    std::size_t m_BitmapOptions = 0;     // HashOptions() m_BitmapBits was rendered with, 0 if none
+    std::vector<Item*> m_PendingPath;    // See InvalidateSubtree()
+    std::size_t m_UpdatedEntries = 0;    // Entries kept and laid out by UpdateLayout(), for the hit rate
+    std::size_t m_KeptEntries = 0;
+    std::optional<UPDATESTATS> m_LastUpdate; // See TakeLastUpdate()
+    int m_MaxLayoutDepth = INT_MAX;      // RecurseLayout() does not descend deeper
+    bool m_ParallelRendering = true;     // See SetParallelRendering()
+    void (CTreeMap::*m_RecurseLayout)(Item*, const CRect&, int) = &CTreeMap::RecurseLayout<ItemAccess>; // See SetItemAccess()
+
+    static constexpr std::size_t CACHE_SIZE = 64 * 1024 * 1024; // Bytes
+    std::list<CACHEENTRY> m_Cache;       // Most recently used first
+
+    static constexpr int INDEX_CELL = 16; // Side of a cell of the spatial index in pixels
+    CSize m_IndexSize;                   // Columns and rows of the spatial index
+    std::vector<int> m_IndexCells;       // Start of the entries of each cell in m_IndexEntries, followed by the end
+    std::vector<int> m_IndexEntries;     // Indices of the drawn entries by cell
+
+    std::vector<double> m_Rows;          // Scratch stacks of KDirStat_LayoutChildren()
+    std::vector<int> m_ChildrenPerRow;
+    std::vector<double> m_ChildWidth;
+    std::vector<ULONGLONG> m_PrefixSums; // Scratch stacks of Strip_LayoutChildren()
+    std::vector<Item*> m_StripChildren;
+
+    static constexpr int MAX_LAYOUT_EXTENT = 1 << 24; // Limits the magnification
+    Viewport m_Viewport;
 
     Options m_Options; // Current options
     double m_Lx = 0.0; // Derived parameters
@@ -0,0 +1,732 @@
+// TreeMapLayout.h - Implementation of the layout templates of CTreeMap
+//
+// WinDirStat - Directory Statistics
+// Copyright (C) 2003-2005 Bernhard Seifert
+// Copyright (C) 2004-2024 WinDirStat Team (windirstat.net)
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#pragma once
+
+// The layout is a template over the access policy to the items, so that
+// the accessors are inlined. The translation unit defining a policy
+// includes this file and instantiates the layout for it, like
+//
+//     template void CTreeMap::RecurseLayout<Policy>(Item* item, const CRect& rc, int parent);
+//
+// so that CTreeMap does not depend on the classes it draws.
+
+#include "TreeMap.h"
+
+#include <algorithm>
+#include <queue>
+#include <ranges>
+#include <vector>
+
+// Subtrees drawn as a single cushion take the color of the group covering most of
+// their size, represented by its largest leaf. As children are sorted by size, the
+// items are visited largest first across all levels until enough have been seen.
+template <class Access>
+CTreeMap::Item* CTreeMap::FindDominantLeaf(Item* item)
+{
+    constexpr auto VISITS = 256;
+    struct CANDIDATE
+    {
+        ULONGLONG size;
+        CTreeMap::Item* parent;
+        int child;
+        bool operator<(const CANDIDATE& other) const { return size < other.size; }
+    };
+    struct GROUP
+    {
+        const void* group;
+        ULONGLONG size;
+        CTreeMap::Item* leaf;
+    };
+
+    // Only the next sibling of a visited child becomes a candidate,
+    // so the candidates grow by at most two per visit
+    std::priority_queue<CANDIDATE> candidates;
+    const auto push = [&candidates](CTreeMap::Item* parent, const int child)
+    {
+        if (child < Access::GetChildCount(parent))
+        {
+            candidates.push({ Access::GetSize(Access::GetChild(parent, child)), parent, child });
+        }
+    };
+
+    std::vector<GROUP> groups;
+    if (!Access::IsLeaf(item)) push(item, 0);
+    for (int visits = 0; visits < VISITS && !candidates.empty(); visits++)
+    {
+        const CANDIDATE candidate = candidates.top();
+        candidates.pop();
+        push(candidate.parent, candidate.child + 1);
+
+        CTreeMap::Item* child = Access::GetChild(candidate.parent, candidate.child);
+        if (!Access::IsLeaf(child))
+        {
+            push(child, 0);
+            continue;
+        }
+
+        const void* group = child->TmiGetGroup();
+        if (const auto entry = std::ranges::find(groups, group, &GROUP::group); entry != groups.end())
+        {
+            entry->size += candidate.size;
+        }
+        else
+        {
+            groups.push_back({ group, candidate.size, child });
+        }
+    }
+
+    if (groups.empty())
+    {
+        while (!Access::IsLeaf(item) && Access::GetChildCount(item) > 0)
+        {
+            item = Access::GetChild(item, 0);
+        }
+        return item;
+    }
+    return std::ranges::max_element(groups, {}, &GROUP::size)->leaf;
+}
+
+template <class Access>
+void CTreeMap::RecurseLayout(Item* item, const CRect& rc, const int parent)
+{
+    ASSERT(rc.Width() >= 0);
+    ASSERT(rc.Height() >= 0);
+
+    ASSERT(Access::GetSize(item) > 0);
+
+    Access::SetRectangle(item, rc);
+
+    // Items outside the visible part of a magnified treemap are not laid out
+    if (parent >= 0 && (rc.right < m_LayoutVisible.left || rc.left > m_LayoutVisible.right ||
+        rc.bottom < m_LayoutVisible.top || rc.top > m_LayoutVisible.bottom))
+    {
+        return;
+    }
+
+    // Entries are addressed by index as m_Layout grows while recursing
+    const int index = static_cast<int>(m_Layout.size());
+    m_Layout.emplace_back(LAYOUTITEM{ item, nullptr, rc, {}, parent < 0 ? 0 : m_Layout[parent].depth + 1, parent, index + 1 });
+
+    const int gridWidth = m_Options.grid ? 1 : 0;
+
+    if (rc.Width() <= gridWidth || rc.Height() <= gridWidth || m_Layout[index].depth >= m_MaxLayoutDepth)
+    {
+        return;
+    }
+
+    // Subtrees below the minimum area are not descended into but drawn
+    // as a single cushion in the color of their largest leaf
+    if (Access::IsLeaf(item) || static_cast<LONGLONG>(rc.Width()) * rc.Height() < m_Options.minimumArea)
+    {
+        Item* leaf = FindDominantLeaf<Access>(item);
+        m_Layout[index].leaf = leaf;
+        if (const void* group = leaf->TmiGetGroup(); group != nullptr)
+        {
+            m_GroupRectangles[group].emplace_back(rc);
+        }
+        return;
+    }
+
+    ASSERT(Access::GetChildCount(item) > 0);
+    ASSERT(Access::GetSize(item) > 0);
+
+    LayoutChildren<Access>(index);
+
+    m_Layout[index].next = static_cast<int>(m_Layout.size());
+}
+
+// My first approach was to make this member pure virtual and have three
+// classes derived from CTreeMap. The disadvantage is then, that we cannot
+// simply have a member variable of type CTreeMap but have to deal with
+// pointers, factory methods and explicit destruction. It's not worth.
+
+template <class Access>
+void CTreeMap::LayoutChildren(const int parent)
+{
+    switch (m_Options.style)
+    {
+    case KDirStatStyle:
+        {
+            KDirStat_LayoutChildren<Access>(parent);
+        }
+        break;
+
+    case SequoiaViewStyle:
+        {
+            SequoiaView_LayoutChildren<Access>(parent);
+        }
+        break;
+
+    case StripStyle:
+        {
+            Strip_LayoutChildren<Access>(parent);
+        }
+        break;
+    }
+}
+
+// I learned this squarification style from the KDirStat executable.
+// It's the most complex one here but also the clearest, imho.
+//
+template <class Access>
+void CTreeMap::KDirStat_LayoutChildren(const int index)
+{
+    const Item* parent = m_Layout[index].item;
+    ASSERT(Access::GetChildCount(parent) > 0);
+
+    const CRect rc = m_Layout[index].rc;
+
+    // m_Rows, m_ChildrenPerRow and m_ChildWidth are used as stacks: the rows
+    // and widths of this parent are appended behind those of its ancestors
+    // and removed at the end, so no memory is allocated per parent.
+    const std::size_t rowBase   = m_Rows.size();
+    const std::size_t widthBase = m_ChildWidth.size();
+    m_ChildWidth.resize(widthBase + Access::GetChildCount(parent));
+
+    const bool horizontalRows = KDirStat_ArrangeChildren<Access>(parent, rc, &m_ChildWidth[widthBase], m_Rows, m_ChildrenPerRow);
+    const std::size_t rowCount = m_Rows.size() - rowBase;
+
+    const int width  = horizontalRows ? rc.Width() : rc.Height();
+    const int height = horizontalRows ? rc.Height() : rc.Width();
+    ASSERT(width >= 0);
+    ASSERT(height >= 0);
+
+    int c = 0;
+    double top = horizontalRows ? rc.top : rc.left;
+    for (std::size_t row = 0; row < rowCount; row++)
+    {
+        const int childrenInRow = m_ChildrenPerRow[rowBase + row];
+        const double fBottom    = top + m_Rows[rowBase + row] * height;
+        int bottom              = static_cast<int>(fBottom);
+        if (row == rowCount - 1)
+        {
+            bottom = horizontalRows ? rc.bottom : rc.right;
+        }
+        double left = horizontalRows ? rc.left : rc.top;
+        for (int i = 0; i < childrenInRow; i++, c++)
+        {
+            Item* child = Access::GetChild(parent, c);
+            ASSERT(m_ChildWidth[widthBase + c] >= 0);
+            const double fRight = left + m_ChildWidth[widthBase + c] * width;
+            int right           = static_cast<int>(fRight);
+
+            const bool lastChild = i == childrenInRow - 1 || m_ChildWidth[widthBase + c + 1] == 0;
+
+            if (lastChild)
+            {
+                right = horizontalRows ? rc.right : rc.bottom;
+            }
+
+            CRect rcChild;
+            if (horizontalRows)
+            {
+                rcChild.left   = static_cast<int>(left);
+                rcChild.right  = right;
+                rcChild.top    = static_cast<int>(top);
+                rcChild.bottom = bottom;
+            }
+            else
+            {
+                rcChild.left   = static_cast<int>(top);
+                rcChild.right  = bottom;
+                rcChild.top    = static_cast<int>(left);
+                rcChild.bottom = right;
+            }
+
+#ifdef _DEBUG
+            if(rcChild.Width() > 0 && rcChild.Height() > 0)
+            {
+                CRect test;
+                test.IntersectRect(rc, rcChild);
+                ASSERT(test == rcChild);
+            }
+#endif
+
+            RecurseLayout<Access>(child, rcChild, index);
+
+            if (lastChild)
+            {
+                i++;
+                c++;
+
+                if (i < childrenInRow)
+                {
+                    Access::SetRectangle(Access::GetChild(parent, c), CRect(-1, -1, -1, -1));
+                }
+
+                c += childrenInRow - i;
+                break;
+            }
+
+            left = fRight;
+        }
+        // This asserts due to rounding error: ASSERT(left == (horizontalRows ? rc.right : rc.bottom));
+        top = fBottom;
+    }
+    // This asserts due to rounding error: ASSERT(top == (horizontalRows ? rc.bottom : rc.right));
+
+    m_Rows.resize(rowBase);
+    m_ChildrenPerRow.resize(rowBase);
+    m_ChildWidth.resize(widthBase);
+}
+
+// return: whether the rows are horizontal.
+//
+template <class Access>
+bool CTreeMap::KDirStat_ArrangeChildren(
+    const Item* parent,
+    const CRect& parentRect,
+    double* childWidth,
+    std::vector<double>& rows,
+    std::vector<int>& childrenPerRow
+)
+{
+    ASSERT(!Access::IsLeaf(parent));
+    ASSERT(Access::GetChildCount(parent) > 0);
+
+    if (Access::GetSize(parent) == 0)
+    {
+        rows.emplace_back(1.0);
+        childrenPerRow.emplace_back(Access::GetChildCount(parent));
+        for (int i = 0; i < Access::GetChildCount(parent); i++)
+        {
+            childWidth[i] = 1.0 / Access::GetChildCount(parent);
+        }
+        return true;
+    }
+
+    const bool horizontalRows = parentRect.Width() >= parentRect.Height();
+
+
+    double width = 1.0;
+    if (horizontalRows)
+    {
+        if (parentRect.Height() > 0)
+        {
+            width = static_cast<double>(parentRect.Width()) / parentRect.Height();
+        }
+    }
+    else
+    {
+        if (parentRect.Width() > 0)
+        {
+            width = static_cast<double>(parentRect.Height()) / parentRect.Width();
+        }
+    }
+
+    int nextChild = 0;
+    while (nextChild < Access::GetChildCount(parent))
+    {
+        int childrenUsed = 0;
+        rows.emplace_back(KDirStat_CalculateNextRow<Access>(parent, nextChild, width, childrenUsed, childWidth));
+        childrenPerRow.emplace_back(childrenUsed);
+        nextChild += childrenUsed;
+    }
+
+    return horizontalRows;
+}
+
+template <class Access>
+double CTreeMap::KDirStat_CalculateNextRow(const Item* parent, const int nextChild, const double width, int& childrenUsed, double* childWidth)
+{
+    static constexpr double _minProportion = 0.4;
+    ASSERT(_minProportion < 1.);
+
+    ASSERT(nextChild < Access::GetChildCount(parent));
+    ASSERT(width >= 1.0);
+
+    const double mySize = static_cast<double>(Access::GetSize(parent));
+    ASSERT(mySize > 0);
+    ULONGLONG sizeUsed = 0;
+    double rowHeight   = 0;
+
+    int i = 0;
+    for (i = nextChild; i < Access::GetChildCount(parent); i++)
+    {
+        const ULONGLONG childSize = Access::GetSize(Access::GetChild(parent, i));
+        if (childSize == 0)
+        {
+            ASSERT(i > nextChild); // first child has size > 0
+            break;
+        }
+
+        sizeUsed += childSize;
+        const double virtualRowHeight = sizeUsed / mySize;
+        ASSERT(virtualRowHeight > 0);
+        ASSERT(virtualRowHeight <= 1);
+
+        // Rectangle(mySize)    = width * 1.0
+        // Rectangle(childSize) = childWidth * virtualRowHeight
+        // Rectangle(childSize) = childSize / mySize * width
+
+        const double childWidth_ = childSize / mySize * width / virtualRowHeight;
+
+        if (childWidth_ / virtualRowHeight < _minProportion)
+        {
+            ASSERT(i > nextChild); // because width >= 1 and _minProportion < 1.
+            // For the first child we have:
+            // childWidth / rowHeight
+            // = childSize / mySize * width / rowHeight / rowHeight
+            // = childSize * width / sizeUsed / sizeUsed * mySize
+            // > childSize * mySize / sizeUsed / sizeUsed
+            // > childSize * childSize / childSize / childSize
+            // = 1 > _minProportion.
+            break;
+        }
+        rowHeight = virtualRowHeight;
+    }
+    ASSERT(i > nextChild);
+
+    // Now i-1 is the last child used
+    // and rowHeight is the height of the row.
+
+    // We add the rest of the children, if their size is 0.
+    while (i < Access::GetChildCount(parent) && Access::GetSize(Access::GetChild(parent, i)) == 0)
+    {
+        i++;
+    }
+
+    childrenUsed = i - nextChild;
+
+    // Now as we know the rowHeight, we compute the widths of our children.
+    for (i = 0; i < childrenUsed; i++)
+    {
+        // Rectangle(1.0 * 1.0) = mySize
+        const double rowSize   = mySize * rowHeight;
+        const double childSize = static_cast<double>(Access::GetSize(Access::GetChild(parent, nextChild + i)));
+        const double cw        = childSize / rowSize;
+        ASSERT(cw >= 0);
+        childWidth[nextChild + i] = cw;
+    }
+
+    return rowHeight;
+}
+
+// The classical squarification method.
+//
+template <class Access>
+void CTreeMap::SequoiaView_LayoutChildren(const int index)
+{
+    const Item* parent = m_Layout[index].item;
+
+    // Rest rectangle to fill
+    CRect remaining(m_Layout[index].rc);
+
+    ASSERT(remaining.Width() > 0);
+    ASSERT(remaining.Height() > 0);
+
+    // Size of rest rectangle
+    ULONGLONG remainingSize = Access::GetSize(parent);
+    ASSERT(remainingSize > 0);
+
+    // Scale factor
+    const double sizePerSquarePixel = static_cast<double>(Access::GetSize(parent)) / remaining.Width() / remaining.Height();
+
+    // First child for next row
+    int head = 0;
+
+    // At least one child left
+    while (head < Access::GetChildCount(parent))
+    {
+        ASSERT(remaining.Width() > 0);
+        ASSERT(remaining.Height() > 0);
+
+        // How we divide the remaining rectangle
+        const bool horizontal = remaining.Width() >= remaining.Height();
+
+        // Height of the new row
+        const int height = horizontal ? remaining.Height() : remaining.Width();
+
+        // Square of height in size scale for ratio formula
+        const double hh = static_cast<double>(height) * height * sizePerSquarePixel;
+        ASSERT(hh > 0);
+
+        // Row will be made up of child(rowBegin)...child(rowEnd - 1)
+        const int rowBegin = head;
+        int rowEnd         = head;
+
+        // Worst ratio so far
+        double worst = DBL_MAX;
+
+        // Maximum size of children in row
+        const ULONGLONG rmax = Access::GetSize(Access::GetChild(parent, rowBegin));
+
+        // Sum of sizes of children in row
+        ULONGLONG sum = 0;
+
+        // This condition will hold at least once.
+        while (rowEnd < Access::GetChildCount(parent))
+        {
+            // We check a virtual row made up of child(rowBegin)...child(rowEnd) here.
+
+            // Minimum size of child in virtual row
+            const ULONGLONG rmin = Access::GetSize(Access::GetChild(parent, rowEnd));
+
+            // If sizes of the rest of the children is zero, we add all of them
+            if (rmin == 0)
+            {
+                rowEnd = Access::GetChildCount(parent);
+                break;
+            }
+
+            // Calculate the worst ratio in virtual row.
+            // Formula taken from the "Squarified Treemaps" paper.
+            // (https://www.win.tue.nl/~vanwijk/)
+
+            const double ss     = (static_cast<double>(sum) + rmin) * (static_cast<double>(sum) + rmin);
+            const double ratio1 = hh * rmax / ss;
+            const double ratio2 = ss / hh / rmin;
+
+            const double nextWorst = max(ratio1, ratio2);
+
+            // Will the ratio get worse?
+            if (nextWorst > worst)
+            {
+                // Yes. Don't take the virtual row, but the
+                // real row (child(rowBegin)..child(rowEnd - 1))
+                // made so far.
+                break;
+            }
+
+            // Here we have decided to add child(rowEnd) to the row.
+            sum += rmin;
+            rowEnd++;
+
+            worst = nextWorst;
+        }
+
+        // Row will be made up of child(rowBegin)...child(rowEnd - 1).
+        // sum is the size of the row.
+
+        // As the size of parent is greater than zero, the size of
+        // the first child must have been greater than zero, too.
+        ASSERT(sum > 0);
+
+        // Width of row
+        int width = horizontal ? remaining.Width() : remaining.Height();
+        ASSERT(width > 0);
+
+        if (sum < remainingSize)
+            width = static_cast<int>(static_cast<double>(sum) / remainingSize * width);
+        // else: use up the whole width
+        // width may be 0 here.
+
+        // Build the rectangles of children.
+        CRect rc;
+        double fBegin;
+        if (horizontal)
+        {
+            rc.left  = remaining.left;
+            rc.right = remaining.left + width;
+            fBegin   = remaining.top;
+        }
+        else
+        {
+            rc.top    = remaining.top;
+            rc.bottom = remaining.top + width;
+            fBegin    = remaining.left;
+        }
+
+        // Now put the children into their places
+        for (int i = rowBegin; i < rowEnd; i++)
+        {
+            const int begin       = static_cast<int>(fBegin);
+            const double fraction = static_cast<double>(Access::GetSize(Access::GetChild(parent, i))) / sum;
+            const double fEnd     = fBegin + fraction * height;
+            int end               = static_cast<int>(fEnd);
+
+            const bool lastChild = i == rowEnd - 1 || Access::GetSize(Access::GetChild(parent, i + 1)) == 0;
+
+            if (lastChild)
+            {
+                // Use up the whole height
+                end = horizontal ? remaining.top + height : remaining.left + height;
+            }
+
+            if (horizontal)
+            {
+                rc.top    = begin;
+                rc.bottom = end;
+            }
+            else
+            {
+                rc.left  = begin;
+                rc.right = end;
+            }
+
+            ASSERT(rc.left <= rc.right);
+            ASSERT(rc.top <= rc.bottom);
+
+            ASSERT(rc.left >= remaining.left);
+            ASSERT(rc.right <= remaining.right);
+            ASSERT(rc.top >= remaining.top);
+            ASSERT(rc.bottom <= remaining.bottom);
+
+            RecurseLayout<Access>(Access::GetChild(parent, i), rc, index);
+
+            if (lastChild)
+                break;
+
+            fBegin = fEnd;
+        }
+
+        // Put the next row into the rest of the rectangle
+        if (horizontal)
+        {
+            remaining.left += width;
+        }
+        else
+        {
+            remaining.top += width;
+        }
+
+        remainingSize -= sum;
+
+        ASSERT(remaining.left <= remaining.right);
+        ASSERT(remaining.top <= remaining.bottom);
+
+        ASSERT(remainingSize >= 0);
+
+        head += rowEnd - rowBegin;
+
+        if (remaining.Width() <= 0 || remaining.Height() <= 0)
+        {
+            if (head < Access::GetChildCount(parent))
+            {
+                Access::SetRectangle(Access::GetChild(parent, head), CRect(-1, -1, -1, -1));
+            }
+
+            break;
+        }
+    }
+    ASSERT(remainingSize == 0);
+    ASSERT(remaining.left == remaining.right || remaining.top == remaining.bottom);
+}
+
+// The strip treemap (Bederson, Shneiderman, Wattenberg) keeps the children
+// in the order of Access::IsStripBefore(), which does not depend on their
+// sizes, so a small change of a size only moves the boundaries
+// next to it instead of rearranging the rows. A strip is extended as long as
+// the worst aspect ratio of its children improves. With prefix sums of the
+// sizes, a strip and the positions of its children are found in constant
+// time per child, and the positions do not accumulate rounding errors.
+//
+template <class Access>
+void CTreeMap::Strip_LayoutChildren(const int index)
+{
+    const Item* parent = m_Layout[index].item;
+    const CRect rc = m_Layout[index].rc;
+    const int count = Access::GetChildCount(parent);
+    ASSERT(count > 0);
+
+    // The children in strip order are m_StripChildren[first, first + count).
+    // Like m_Rows, m_StripChildren and m_PrefixSums are used as stacks shared
+    // with the ancestors, so they are addressed by index while recursing.
+    const std::size_t first = m_StripChildren.size();
+    for (int i = 0; i < count; i++)
+    {
+        m_StripChildren.push_back(Access::GetChild(parent, i));
+    }
+    std::stable_sort(m_StripChildren.begin() + static_cast<std::ptrdiff_t>(first), m_StripChildren.end(), &Access::IsStripBefore);
+
+    // The sizes of the children [a, b) add up to m_PrefixSums[base + b] - m_PrefixSums[base + a]
+    const std::size_t base = m_PrefixSums.size();
+    m_PrefixSums.resize(base + count + 1);
+    m_PrefixSums[base] = 0;
+    for (int i = 0; i < count; i++)
+    {
+        m_PrefixSums[base + i + 1] = m_PrefixSums[base + i] + Access::GetSize(m_StripChildren[first + i]);
+    }
+    const auto sum = [&](const int a, const int b) { return m_PrefixSums[base + b] - m_PrefixSums[base + a]; };
+
+    const double total = static_cast<double>(sum(0, count));
+    ASSERT(total > 0);
+
+    // Strips run along the longer side and are stacked along the shorter one
+    const bool horizontal = rc.Width() >= rc.Height();
+    const int length      = horizontal ? rc.Width() : rc.Height();
+    const int thickness   = horizontal ? rc.Height() : rc.Width();
+    const int lengthBegin = horizontal ? rc.left : rc.top;
+    const int stackBegin  = horizontal ? rc.top : rc.left;
+
+    // Square pixels per size unit
+    const double area = static_cast<double>(length) * thickness / total;
+    const double length2 = static_cast<double>(length) * length;
+
+    int begin = 0;
+    while (begin < count)
+    {
+        // For a strip of size s, a child of size r is r * length / s long
+        // and area * s / length thick, so the worst ratio depends only on
+        // the smallest and the largest child of the strip.
+        int end = begin;
+        ULONGLONG rmin = ULLONG_MAX;
+        ULONGLONG rmax = 0;
+        double worst   = DBL_MAX;
+        for (int i = begin; i < count; i++)
+        {
+            const ULONGLONG size = sum(i, i + 1);
+            if (size > 0)
+            {
+                const double s     = static_cast<double>(sum(begin, i + 1));
+                const double ss    = area * s * s;
+                const double ratio = max(static_cast<double>(max(rmax, size)) * length2 / ss, ss / (static_cast<double>(min(rmin, size)) * length2));
+                if (ratio > worst)
+                {
+                    break;
+                }
+                worst = ratio;
+                rmin  = min(rmin, size);
+                rmax  = max(rmax, size);
+            }
+            end = i + 1;
+        }
+
+        const int top    = stackBegin + static_cast<int>(sum(0, begin) / total * thickness);
+        const int bottom = end == count ? stackBegin + thickness : stackBegin + static_cast<int>(sum(0, end) / total * thickness);
+        const double stripSize = static_cast<double>(sum(begin, end));
+
+        for (int i = begin; i < end; i++)
+        {
+            Item* child = m_StripChildren[first + i];
+            if (sum(i, i + 1) == 0)
+            {
+                Access::SetRectangle(child, CRect(-1, -1, -1, -1));
+                continue;
+            }
+
+            const int left  = lengthBegin + static_cast<int>(sum(begin, i) / stripSize * length);
+            const int right = sum(i + 1, end) == 0 ? lengthBegin + length : lengthBegin + static_cast<int>(sum(begin, i + 1) / stripSize * length);
+
+            const CRect rcChild = horizontal ? CRect(left, top, right, bottom) : CRect(top, left, bottom, right);
+            ASSERT(rcChild.left >= rc.left && rcChild.right <= rc.right);
+            ASSERT(rcChild.top >= rc.top && rcChild.bottom <= rc.bottom);
+
+            RecurseLayout<Access>(child, rcChild, index);
+        }
+
+        begin = end;
+    }
+
+    m_PrefixSums.resize(base);
+    m_StripChildren.resize(first);
+}
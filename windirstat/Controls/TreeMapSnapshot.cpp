@@ -0,0 +1,52 @@
+// TreeMapSnapshot.cpp - Implementation of CTreeMapSnapshot
+//
+// WinDirStat - Directory Statistics
+// Copyright (C) 2024 WinDirStat Team (windirstat.net)
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#include "stdafx.h"
+#include "Item.h"
+#include "TreeMapSnapshot.h"
+
+#include <algorithm>
+
+CTreeMapSnapshot::CTreeMapSnapshot(const CItem* item, const int depth, const ColorFunction& color)
+{
+    if (depth > 0 && !item->TmiIsLeaf())
+    {
+        for (const CItem* child : item->CopyChildren())
+        {
+            // Items which have just been found may not have a size yet
+            auto node = std::make_unique<CTreeMapSnapshot>(child, depth - 1, color);
+            if (node->m_Size == 0) continue;
+            m_Size += node->m_Size;
+            m_Children.emplace_back(std::move(node));
+        }
+    }
+
+    if (!m_Children.empty())
+    {
+        std::ranges::sort(m_Children, [](const auto& a, const auto& b) { return a->m_Size > b->m_Size; });
+        return;
+    }
+
+    m_Size = item->TmiGetSize();
+    if (item->TmiIsLeaf())
+    {
+        m_Color = color(item);
+    }
+}
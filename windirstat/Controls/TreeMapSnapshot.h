@@ -0,0 +1,58 @@
+// TreeMapSnapshot.h - Declaration of CTreeMapSnapshot
+//
+// WinDirStat - Directory Statistics
+// Copyright (C) 2024 WinDirStat Team (windirstat.net)
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#pragma once
+
+#include "TreeMap.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+class CItem;
+
+//
+// CTreeMapSnapshot. A copy of an item tree down to a limited depth, which
+// can be laid out independently of the document. The size of a folder is
+// the sum of its copied children, so the copy is consistent even while the
+// scanning threads keep adding to the original. Children are sorted by size.
+// Leaves are colored by the given function, folders below the depth limit gray.
+//
+class CTreeMapSnapshot final : public CTreeMap::Item
+{
+public:
+    using ColorFunction = std::function<COLORREF(const CItem*)>;
+
+    CTreeMapSnapshot(const CItem* item, int depth, const ColorFunction& color);
+
+    bool TmiIsLeaf() const override { return m_Children.empty(); }
+    CRect TmiGetRectangle() const override { return m_Rect; }
+    void TmiSetRectangle(const CRect& rc) override { m_Rect = rc; }
+    COLORREF TmiGetGraphColor() const override { return m_Color; }
+    int TmiGetChildCount() const override { return static_cast<int>(m_Children.size()); }
+    CTreeMap::Item* TmiGetChild(const int c) const override { return m_Children[c].get(); }
+    ULONGLONG TmiGetSize() const override { return m_Size; }
+
+private:
+    std::vector<std::unique_ptr<CTreeMapSnapshot>> m_Children;
+    CRect m_Rect;
+    ULONGLONG m_Size = 0;
+    COLORREF m_Color = RGB(160, 160, 160);
+};
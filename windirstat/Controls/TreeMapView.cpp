@@ -27,7 +27,29 @@
 #include "Item.h"
 #include "SelectObject.h"
 #include "TreeMapView.h"
+#include "TreeMapSnapshot.h"
 #include "Localization.h"
+#include "GlobalHelpers.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <tuple>
+
+namespace
+{
+    // Minimum time between two frames of the progressive treemap
+    constexpr auto PROGRESSIVE_INTERVAL = std::chrono::milliseconds(2000);
+
+    // Magnification of the viewport per notch of the mouse wheel
+    constexpr double WHEEL_ZOOM_FACTOR = 1.25;
+
+    // Orders highlight rectangles for the set operations of UpdateHighlights()
+    bool CompareRectangles(const CRect& a, const CRect& b)
+    {
+        return std::tie(a.left, a.top, a.right, a.bottom) < std::tie(b.left, b.top, b.right, b.bottom);
+    }
+}
 
 IMPLEMENT_DYNCREATE(CTreeMapView, CView)
 
@@ -37,10 +59,19 @@ BEGIN_MESSAGE_MAP(CTreeMapView, CView)
     ON_WM_SETFOCUS()
     ON_WM_CONTEXTMENU()
     ON_WM_MOUSEMOVE()
+    ON_WM_MOUSEWHEEL()
+    ON_WM_MBUTTONDOWN()
+    ON_WM_MBUTTONUP()
     ON_WM_DESTROY()
     ON_WM_TIMER()
 END_MESSAGE_MAP()
 
+CTreeMapView::CTreeMapView()
+{
+    // The view only shows CItems, so the layout reads them directly
+    m_TreeMap.SetItemAccess<CItem::TreeMapAccess>();
+}
+
 void CTreeMapView::SuspendRecalculationDrawing(const bool suspend)
 {
     m_DrawingSuspended = suspend;
@@ -50,6 +81,177 @@ void CTreeMapView::SuspendRecalculationDrawing(const bool suspend)
     }
 }
 
+// Must be called before items are removed or resized. Drops the treemap
+// layouts which contain any of the items or are contained in one of them,
+// or all layouts if items is empty.
+//
+void CTreeMapView::InvalidateItems(const std::vector<CItem*>& items)
+{
+    if (items.empty())
+    {
+        m_TreeMap.InvalidateLayout();
+        return;
+    }
+
+    const auto affected = [&items](const CTreeMap::Item* root)
+    {
+        const auto rootItem = static_cast<const CItem*>(root);
+        return std::ranges::any_of(items, [rootItem](const CItem* item)
+        {
+            return item->IsAncestorOf(rootItem) || rootItem->IsAncestorOf(item);
+        });
+    };
+
+    // If all changes are below the zoom item, the current layout is kept
+    // and only the part which contains the changed items is updated
+    const CItem* common = items.front();
+    for (const CItem* item : items)
+    {
+        common = common != nullptr ? CItem::FindCommonAncestor(common, item) : nullptr;
+    }
+
+    CItem* zoom = GetDocument()->GetZoomItem();
+    if (common == nullptr || common == zoom || zoom == nullptr || !zoom->IsAncestorOf(common))
+    {
+        m_TreeMap.InvalidateLayout(affected);
+        return;
+    }
+
+    std::vector<CTreeMap::Item*> path;
+    for (CItem* item = common->GetParent(); item != zoom; item = item->GetParent())
+    {
+        path.emplace_back(item);
+    }
+    path.emplace_back(zoom);
+    std::ranges::reverse(path);
+
+    m_TreeMap.InvalidateSubtree(path, affected);
+}
+
+// Starts a thread which periodically renders the treemap of the items
+// found so far. It uses at most COptions::TreeMapProgressiveBudget percent
+// of one processor and never blocks the scanning threads.
+//
+void CTreeMapView::StartProgressiveDrawing(const CItem* root)
+{
+    StopProgressiveDrawing();
+    {
+        std::lock_guard lock(m_ProgressiveMutex);
+        m_ProgressiveFrames = 0;
+    }
+
+    const int budget = COptions::TreeMapProgressiveBudget;
+    if (budget == 0 || root == nullptr)
+    {
+        return;
+    }
+
+    const int depth = COptions::TreeMapProgressiveDepth;
+    const CTreeMap::Options options = COptions::TreeMapOptions;
+
+    m_ProgressiveThread = std::jthread([this, root, budget, depth, options](const std::stop_token& stop)
+    {
+        // Extension colors are not known before the scan has finished,
+        // so files are colored from the default palette by their extension
+        std::vector<COLORREF> palette;
+        CTreeMap::GetDefaultPalette(palette);
+        const auto color = [&palette](const CItem* item)
+        {
+            const void* group = item->TmiGetGroup();
+            return group != nullptr ? palette[std::hash<const void*>{}(group) % palette.size()] : item->TmiGetGraphColor();
+        };
+
+        CTreeMap treemap;
+        std::vector<COLORREF> bits;
+
+        std::mutex mutex;
+        std::condition_variable_any wakeup;
+        auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(PROGRESSIVE_INTERVAL);
+        const auto scanStart = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::duration busy{};
+        int frames = 0;
+
+        for (;;)
+        {
+            {
+                std::unique_lock lock(mutex);
+                wakeup.wait_for(lock, stop, interval, [] { return false; });
+            }
+            if (stop.stop_requested()) break;
+            if (CMainFrame::Get()->IsScanSuspended()) continue;
+
+            CRect rc;
+            ::GetClientRect(m_hWnd, rc);
+
+            const auto frameStart = std::chrono::steady_clock::now();
+            CTreeMapSnapshot snapshot(root, depth, color);
+            const bool drawn = treemap.RenderTreeMap(bits, rc.Size(), &snapshot, &options);
+
+            // The layout refers to the snapshot, which is gone after this frame
+            treemap.InvalidateLayout();
+            if (!drawn) continue;
+
+            {
+                std::lock_guard lock(m_ProgressiveMutex);
+                m_ProgressiveBits.swap(bits);
+                m_ProgressiveSize = rc.Size();
+            }
+            ::InvalidateRect(m_hWnd, nullptr, FALSE);
+
+            // Wait long enough to keep the share of this thread within the budget
+            const auto elapsed = std::chrono::steady_clock::now() - frameStart;
+            interval = max(std::chrono::duration_cast<std::chrono::steady_clock::duration>(PROGRESSIVE_INTERVAL),
+                elapsed * (100 - budget) / budget);
+            busy += elapsed;
+            frames++;
+        }
+
+        // Keep the overhead so it can be reported once the scan has finished
+        std::lock_guard lock(m_ProgressiveMutex);
+        m_ProgressiveFrames = frames;
+        m_ProgressiveBusy = std::chrono::duration_cast<std::chrono::milliseconds>(busy);
+        m_ProgressiveShare = 100.0 * busy.count() / max((std::chrono::steady_clock::now() - scanStart).count(), 1LL);
+    });
+}
+
+void CTreeMapView::StopProgressiveDrawing()
+{
+    if (m_ProgressiveThread.joinable())
+    {
+        m_ProgressiveThread.request_stop();
+        m_ProgressiveThread.join();
+    }
+
+    std::lock_guard lock(m_ProgressiveMutex);
+    m_ProgressiveBits.clear();
+    m_ProgressiveBits.shrink_to_fit();
+}
+
+// Describes how much of the treemap the last refresh of a subtree had to lay
+// out and render again, or returns an empty string if it was drawn anew.
+//
+std::wstring CTreeMapView::GetUpdateSummary()
+{
+    const auto update = m_TreeMap.TakeLastUpdate();
+    if (!update.has_value()) return {};
+
+    return Localization::Format(IDS_TREEMAP_UPDATEDssss, update->milliseconds,
+        100.0 * update->keptEntries / (std::max)(update->entries, std::size_t{ 1 }), update->keptOverall,
+        100.0 * update->pixels / (std::max)(update->totalPixels, 1LL));
+}
+
+// Describes the time the last progressive drawing took from the scan,
+// or returns an empty string if it did not draw anything.
+//
+std::wstring CTreeMapView::GetProgressiveSummary()
+{
+    std::lock_guard lock(m_ProgressiveMutex);
+    if (m_ProgressiveFrames == 0) return {};
+
+    return Localization::Format(IDS_TREEMAP_PROGRESSIVEsss, FormatCount(static_cast<ULONGLONG>(m_ProgressiveFrames)),
+        FormatCount(static_cast<ULONGLONG>(m_ProgressiveBusy.count())), m_ProgressiveShare);
+}
+
 bool CTreeMapView::IsShowTreeMap() const
 {
     return m_ShowTreeMap;
@@ -116,9 +318,39 @@ void CTreeMapView::DrawEmptyView(CDC* pDC)
     }
 }
 
+// Draws the last frame of the progressive treemap, if there is one
+bool CTreeMapView::DrawProgressive(CDC* pDC)
+{
+    std::lock_guard lock(m_ProgressiveMutex);
+    if (m_ProgressiveBits.empty())
+    {
+        return false;
+    }
+
+    CRect rc;
+    GetClientRect(rc);
+
+    BITMAPINFO bmi = {};
+    bmi.bmiHeader.biSize        = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth       = m_ProgressiveSize.cx;
+    bmi.bmiHeader.biHeight      = -m_ProgressiveSize.cy;
+    bmi.bmiHeader.biPlanes      = 1;
+    bmi.bmiHeader.biBitCount    = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    VERIFY(::StretchDIBits(pDC->m_hDC, 0, 0, rc.Width(), rc.Height(), 0, 0, m_ProgressiveSize.cx, m_ProgressiveSize.cy,
+        m_ProgressiveBits.data(), &bmi, DIB_RGB_COLORS, SRCCOPY) != 0);
+
+    return true;
+}
+
 void CTreeMapView::OnDraw(CDC * pDC)
 {
     const CItem* root = GetDocument()->GetRootItem();
+    if (root != nullptr && !root->IsDone() && m_ShowTreeMap && DrawProgressive(pDC))
+    {
+        return;
+    }
+
     if (root == nullptr || !root->IsDone() || m_DrawingSuspended || !m_ShowTreeMap)
     {
         DrawEmptyView(pDC);
@@ -146,14 +378,25 @@ void CTreeMapView::OnDraw(CDC * pDC)
             DrawZoomFrame(&dcmem, rc);
         }
 
+        // Leaves are drawn by several threads, so the extension
+        // colors must not be rebuilt lazily during drawing
+        GetDocument()->GetExtensionData();
+
         m_TreeMap.DrawTreeMap(&dcmem, rc, GetDocument()->GetZoomItem(), &COptions::TreeMapOptions);
+
+        m_Highlights.clear();
+        CollectHighlights(m_Highlights);
     }
 
     CSelectObject sobmp2(&dcmem, &m_Bitmap);
 
-    pDC->BitBlt(0, 0, m_Size.cx, m_Size.cy, &dcmem, 0, 0, SRCCOPY);
+    // Only the invalidated part is copied from the cached treemap and
+    // the highlights are drawn on top of it
+    CRect rcClip;
+    pDC->GetClipBox(rcClip);
+    pDC->BitBlt(rcClip.left, rcClip.top, rcClip.Width(), rcClip.Height(), &dcmem, rcClip.left, rcClip.top, SRCCOPY);
 
-    DrawHighlights(pDC);
+    DrawHighlights(pDC, rcClip);
 }
 
 void CTreeMapView::DrawZoomFrame(CDC* pdc, CRect& rc)
@@ -179,88 +422,157 @@ void CTreeMapView::DrawZoomFrame(CDC* pdc, CRect& rc)
     rc.DeflateRect(w, w);
 }
 
-void CTreeMapView::DrawHighlights(CDC* pdc)
+void CTreeMapView::DrawHighlights(CDC* pdc, const CRect& rcClip)
+{
+    CPen pen(PS_SOLID, 1, COptions::TreeMapHighlightColor);
+    CSelectObject sopen(pdc, &pen);
+    CSelectStockObject sobrush(pdc, NULL_BRUSH);
+
+    for (const auto& highlight : m_Highlights)
+    {
+        CRect rc;
+        if (rc.IntersectRect(highlight, rcClip))
+        {
+            rc = highlight;
+            RenderHighlightRectangle(pdc, rc);
+        }
+    }
+}
+
+// Determines the highlight rectangles and invalidates only those which
+// appeared or disappeared, so a selection change does not repaint the
+// whole treemap.
+//
+void CTreeMapView::UpdateHighlights(const bool redrawAll)
+{
+    if (!IsDrawn())
+    {
+        Invalidate();
+        return;
+    }
+
+    std::vector<CRect> highlights;
+    CollectHighlights(highlights);
+
+    std::vector<CRect> dirty;
+    if (redrawAll)
+    {
+        std::ranges::set_union(m_Highlights, highlights, std::back_inserter(dirty), CompareRectangles);
+    }
+    else
+    {
+        std::ranges::set_symmetric_difference(m_Highlights, highlights, std::back_inserter(dirty), CompareRectangles);
+    }
+
+    m_Highlights = std::move(highlights);
+
+    // Beyond some point a single repaint is cheaper than a huge update region
+    if (dirty.size() > 256)
+    {
+        Invalidate(FALSE);
+        return;
+    }
+
+    for (const auto& rc : dirty)
+    {
+        InvalidateRect(rc, FALSE);
+    }
+}
+
+void CTreeMapView::CollectHighlights(std::vector<CRect>& highlights)
 {
     switch (CMainFrame::Get()->GetLogicalFocus())
     {
     case LF_DUPELIST:
     case LF_FILETREE:
-        DrawSelection(pdc);
+        CollectSelection(highlights);
         break;
     case LF_EXTENSIONLIST:
-        DrawHighlightExtension(pdc);
+        CollectHighlightExtension(highlights);
         break;
     case LF_NONE:
         break;
     }
-}
 
-void CTreeMapView::DrawHighlightExtension(CDC* pdc)
-{
-    CWaitCursor wc;
-
-    CPen pen(PS_SOLID, 1, COptions::TreeMapHighlightColor);
-    CSelectObject sopen(pdc, &pen);
-    CSelectStockObject sobrush(pdc, NULL_BRUSH);
-    RecurseHighlightExtension(pdc, GetDocument()->GetZoomItem());
+    std::ranges::sort(highlights, CompareRectangles);
 }
 
-void CTreeMapView::RecurseHighlightExtension(CDC* pdc, const CItem* item)
+void CTreeMapView::CollectHighlightExtension(std::vector<CRect>& highlights)
 {
-    CRect rc(item->TmiGetRectangle());
-    if (rc.Width() <= 0 || rc.Height() <= 0)
-    {
-        return;
-    }
-
-    if (item->TmiIsLeaf())
-    {
-        if (item->IsType(IT_FILE) && _wcsicmp(item->GetExtension().c_str(), GetDocument()->GetHighlightExtension().c_str()) == 0)
-        {
-            RenderHighlightRectangle(pdc, rc);
-        }
-    }
-    else for (const auto& child : item->GetChildren())
+    // The layout has indexed the leaves by their extension
+    const LPCWSTR ext = CItem::FindExtensionId(GetDocument()->GetHighlightExtension());
+    if (ext != nullptr)
     {
-        if (child->TmiGetSize() == 0)
-        {
-            break;
-        }
-        if (child->TmiGetRectangle().left == -1)
+        CRect rcClient;
+        GetClientRect(rcClient);
+        const CPoint origin = m_TreeMap.GetVisibleRect().TopLeft();
+        for (CRect rc : m_TreeMap.GetGroupRectangles(ext))
         {
-            break;
+            rc.OffsetRect(-origin);
+            if (rc.IntersectRect(rc, rcClient))
+            {
+                highlights.emplace_back(rc);
+            }
         }
-        RecurseHighlightExtension(pdc, child);
     }
 }
 
-void CTreeMapView::DrawSelection(CDC* pdc)
+void CTreeMapView::CollectSelection(std::vector<CRect>& highlights)
 {
-    CSelectStockObject sobrush(pdc, NULL_BRUSH);
-
-    CPen pen(PS_SOLID, 1, COptions::TreeMapHighlightColor);
-    CSelectObject sopen(pdc, &pen);
-
     const auto& items = CFileTreeControl::Get()->GetAllSelected<CItem>();
     for (const auto& item : items)
     {
-        HighlightSelectedItem(pdc, item, items.size() == 1);
+        const CRect rc = GetSelectionRectangle(item, items.size() == 1);
+        if (rc.Width() > 0 && rc.Height() > 0)
+        {
+            highlights.emplace_back(rc);
+        }
     }
 }
 
-// A pen and the null brush must be selected.
-// Draws the highlight rectangle of item. If single, the rectangle is slightly
+// Returns the highlight rectangle of item. If single, the rectangle is slightly
 // bigger than the item rect, else it fits inside.
 //
-void CTreeMapView::HighlightSelectedItem(CDC* pdc, const CItem* item, const bool single)
+CRect CTreeMapView::GetSelectionRectangle(const CItem* item, const bool single)
 {
-    CRect rc(item->TmiGetRectangle());
+    // The rectangle of the item may stem from an older layout, so it is looked up
+    // in the current one, where small subtrees are drawn as a single cushion
+    std::vector<const CTreeMap::Item*> path;
+    for (const CItem* p = item; p != nullptr; p = p->GetParent())
+    {
+        path.push_back(p);
+    }
+    std::ranges::reverse(path);
+    const auto root = std::ranges::find(path, GetDocument()->GetZoomItem());
+    if (root == path.end())
+    {
+        return CRect();
+    }
+    path.erase(path.begin(), root);
 
-    if (single)
+    CRect rc(m_TreeMap.GetDrawnRectangle(path));
+    if (rc.IsRectEmpty())
     {
-        CRect rcClient;
-        GetClientRect(rcClient);
+        return CRect();
+    }
+    rc.OffsetRect(-m_TreeMap.GetVisibleRect().TopLeft());
+
+    CRect rcClient;
+    GetClientRect(rcClient);
+
+    // In a magnified treemap, only the visible part is highlighted
+    if (m_TreeMap.GetViewport().magnification > 1.0)
+    {
+        CRect rcVisible = rcClient;
+        rcVisible.InflateRect(1, 1);
+        if (!rc.IntersectRect(rc, rcVisible))
+        {
+            return CRect();
+        }
+    }
 
+    if (single)
+    {
         if (m_TreeMap.GetOptions().grid)
         {
             rc.right++;
@@ -277,12 +589,7 @@ void CTreeMapView::HighlightSelectedItem(CDC* pdc, const CItem* item, const bool
             rc.bottom++;
     }
 
-    if (rc.Width() <= 0 || rc.Height() <= 0)
-    {
-        return;
-    }
-
-    RenderHighlightRectangle(pdc, rc);
+    return rc;
 }
 
 // A pen and the null brush must be selected.
@@ -326,7 +633,7 @@ void CTreeMapView::OnLButtonDown(const UINT nFlags, const CPoint point)
     const CItem* root = GetDocument()->GetRootItem();
     if (root != nullptr && root->IsDone() && IsDrawn())
     {
-        const auto item = static_cast<CItem*>(m_TreeMap.FindItemByPoint(GetDocument()->GetZoomItem(), point));
+        const auto item = static_cast<CItem*>(m_TreeMap.FindItemByPoint(point));
         if (item == nullptr)
         {
             return;
@@ -366,6 +673,8 @@ void CTreeMapView::Inactivate()
 
 void CTreeMapView::EmptyView()
 {
+    m_TreeMap.InvalidateLayout();
+
     if (m_Bitmap.m_hObject != nullptr)
     {
         m_Bitmap.DeleteObject();
@@ -393,6 +702,7 @@ void CTreeMapView::OnUpdate(CView* pSender, const LPARAM lHint, CObject* pHint)
     {
     case HINT_NEWROOT:
         {
+            m_TreeMap.SetViewport({});
             EmptyView();
             CView::OnUpdate(pSender, lHint, pHint);
         }
@@ -400,23 +710,53 @@ void CTreeMapView::OnUpdate(CView* pSender, const LPARAM lHint, CObject* pHint)
 
     case HINT_SELECTIONACTION:
     case HINT_SELECTIONREFRESH:
-    case HINT_SELECTIONSTYLECHANGED:
     case HINT_EXTENSIONSELECTIONCHANGED:
         {
-            CView::OnUpdate(pSender, lHint, pHint);
+            UpdateHighlights();
+        }
+        break;
+
+    case HINT_SELECTIONSTYLECHANGED:
+        {
+            // The highlight color may have changed
+            UpdateHighlights(true);
         }
         break;
 
     case HINT_TREEMAPSTYLECHANGED:
-    case HINT_ZOOMCHANGED:
         {
             Inactivate();
             CView::OnUpdate(pSender, lHint, pHint);
         }
         break;
 
+    case HINT_ZOOMCHANGED:
+        {
+            // Zoom levels shown before are usually cached by m_TreeMap,
+            // so the view is not dimmed while waiting for the new one
+            m_TreeMap.SetViewport({});
+            m_Bitmap.DeleteObject();
+            CView::OnUpdate(pSender, lHint, pHint);
+        }
+        break;
+
     case HINT_NULL:
         {
+            // Changed items have been passed to InvalidateItems() before,
+            // but the extension colors may have changed since
+            if (GetDocument()->IsRootDone())
+            {
+                std::size_t hash = 0;
+                for (const auto& [ext, record] : *GetDocument()->GetExtensionData())
+                {
+                    hash += std::hash<std::wstring>{}(ext) ^ record.color;
+                }
+                if (hash != m_ExtensionColorsHash)
+                {
+                    m_ExtensionColorsHash = hash;
+                    m_TreeMap.InvalidateBitmaps();
+                }
+            }
             CView::OnUpdate(pSender, lHint, pHint);
         }
         break;
@@ -439,11 +779,17 @@ void CTreeMapView::OnContextMenu(CWnd* /*pWnd*/, const CPoint point)
     }
 }
 
-void CTreeMapView::OnMouseMove(UINT /*nFlags*/, const CPoint point)
+void CTreeMapView::OnMouseMove(const UINT nFlags, const CPoint point)
 {
-    if (GetDocument()->IsRootDone() && IsDrawn())
+    if (GetCapture() == this && (nFlags & MK_MBUTTON) != 0)
+    {
+        m_TreeMap.PanViewport(GetTreeMapRect().Size(), m_PanPoint - point);
+        m_PanPoint = point;
+        RedrawViewport();
+    }
+    else if (GetDocument()->IsRootDone() && IsDrawn())
     {
-        const auto item = static_cast<const CItem*>(m_TreeMap.FindItemByPoint(GetDocument()->GetZoomItem(), point));
+        const auto item = static_cast<const CItem*>(m_TreeMap.FindItemByPoint(point));
         if (item != nullptr)
         {
             CMainFrame::Get()->SetMessageText(item->GetPath());
@@ -455,6 +801,65 @@ void CTreeMapView::OnMouseMove(UINT /*nFlags*/, const CPoint point)
     }
 }
 
+// The mouse wheel magnifies the part of the treemap below the cursor.
+// Only that part is laid out and rendered.
+//
+BOOL CTreeMapView::OnMouseWheel(const UINT nFlags, const short zDelta, const CPoint pt)
+{
+    if (!GetDocument()->IsRootDone() || !IsDrawn())
+    {
+        return CView::OnMouseWheel(nFlags, zDelta, pt);
+    }
+
+    CPoint point = pt;
+    ScreenToClient(&point);
+    const CRect rc = GetTreeMapRect();
+    m_TreeMap.ZoomViewport(rc.Size(), point - rc.TopLeft(), pow(WHEEL_ZOOM_FACTOR, static_cast<double>(zDelta) / WHEEL_DELTA));
+    RedrawViewport();
+
+    return TRUE;
+}
+
+// Dragging with the middle button moves a magnified treemap
+//
+void CTreeMapView::OnMButtonDown(const UINT nFlags, const CPoint point)
+{
+    if (GetDocument()->IsRootDone() && IsDrawn() && m_TreeMap.GetViewport().magnification > 1.0)
+    {
+        m_PanPoint = point;
+        SetCapture();
+    }
+    CView::OnMButtonDown(nFlags, point);
+}
+
+void CTreeMapView::OnMButtonUp(const UINT nFlags, const CPoint point)
+{
+    if (GetCapture() == this)
+    {
+        ReleaseCapture();
+    }
+    CView::OnMButtonUp(nFlags, point);
+}
+
+// The area of the client rectangle covered by the treemap
+//
+CRect CTreeMapView::GetTreeMapRect()
+{
+    CRect rc;
+    GetClientRect(rc);
+    if (GetDocument()->IsZoomed())
+    {
+        rc.DeflateRect(4, 4);
+    }
+    return rc;
+}
+
+void CTreeMapView::RedrawViewport()
+{
+    m_Bitmap.DeleteObject();
+    Invalidate(FALSE);
+}
+
 void CTreeMapView::OnDestroy()
 {
     if (m_Timer != NULL)
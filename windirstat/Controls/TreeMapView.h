@@ -23,6 +23,11 @@
 
 #include "TreeMap.h"
 
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
 class CDirStatDoc;
 class CItem;
 
@@ -32,7 +37,7 @@ class CItem;
 class CTreeMapView final : public CView
 {
 protected:
-    CTreeMapView() = default;
+    CTreeMapView();
     DECLARE_DYNCREATE(CTreeMapView)
 
     ~CTreeMapView() override = default;
@@ -44,6 +49,11 @@ protected:
     }
 
     void SuspendRecalculationDrawing(bool suspend);
+    void InvalidateItems(const std::vector<CItem*>& items);
+    void StartProgressiveDrawing(const CItem* root);
+    void StopProgressiveDrawing();
+    std::wstring GetProgressiveSummary();
+    std::wstring GetUpdateSummary();
     bool IsShowTreeMap() const;
     void ShowTreeMap(bool show);
     void DrawEmptyView();
@@ -56,18 +66,22 @@ protected:
     void Inactivate();
     void EmptyView();
     void DrawEmptyView(CDC* pDC);
+    bool DrawProgressive(CDC* pDC);
 
     void DrawZoomFrame(CDC* pdc, CRect& rc);
-    void DrawHighlights(CDC* pdc);
-
-    void DrawHighlightExtension(CDC* pdc);
-    void RecurseHighlightExtension(CDC* pdc, const CItem* item);
+    void DrawHighlights(CDC* pdc, const CRect& rcClip);
+    void UpdateHighlights(bool redrawAll = false);
 
-    void DrawSelection(CDC* pdc);
+    void CollectHighlights(std::vector<CRect>& highlights);
+    void CollectHighlightExtension(std::vector<CRect>& highlights);
+    void CollectSelection(std::vector<CRect>& highlights);
 
-    void HighlightSelectedItem(CDC* pdc, const CItem* item, bool single);
+    CRect GetSelectionRectangle(const CItem* item, bool single);
     void RenderHighlightRectangle(CDC* pdc, CRect& rc);
 
+    CRect GetTreeMapRect();
+    void RedrawViewport();
+
     bool m_DrawingSuspended = false; // True while the user is resizing the window.
     bool m_ShowTreeMap = true;       // False, if the user switched off the treemap (by F9).
     CSize m_Size{ 0, 0 };            // Current size of view
@@ -75,7 +89,18 @@ protected:
     CBitmap m_Bitmap;                // Cached view. If m_hObject is NULL, the view must be recalculated.
     CSize m_DimmedSize{ 0,0 };       // Size of bitmap m_Dimmed
     CBitmap m_Dimmed;                // Dimmed view. Used during refresh to avoid the ooops-effect.
+    std::vector<CRect> m_Highlights; // Highlight rectangles drawn on top of m_Bitmap, sorted.
     UINT_PTR m_Timer = 0;            // We need a timer to realize when the mouse left our window.
+    std::size_t m_ExtensionColorsHash = 0; // Extension colors m_TreeMap has rendered with
+    CPoint m_PanPoint;               // Last mouse position while moving a magnified treemap
+
+    std::jthread m_ProgressiveThread;        // Renders the treemap of the items found so far while scanning
+    std::mutex m_ProgressiveMutex;           // Protects the two members below
+    std::vector<COLORREF> m_ProgressiveBits; // Last frame of m_ProgressiveThread, empty if none
+    CSize m_ProgressiveSize{ 0, 0 };         // Size of that frame
+    int m_ProgressiveFrames = 0;             // Frames drawn by the last m_ProgressiveThread
+    std::chrono::milliseconds m_ProgressiveBusy{}; // Time spent drawing them
+    double m_ProgressiveShare = 0.0;         // Percentage of the scan time spent drawing them
 
     DECLARE_MESSAGE_MAP()
     afx_msg void OnSize(UINT nType, int cx, int cy);
@@ -83,6 +108,9 @@ protected:
     afx_msg void OnSetFocus(CWnd* pOldWnd);
     afx_msg void OnContextMenu(CWnd* pWnd, CPoint point);
     afx_msg void OnMouseMove(UINT nFlags, CPoint point);
+    afx_msg BOOL OnMouseWheel(UINT nFlags, short zDelta, CPoint pt);
+    afx_msg void OnMButtonDown(UINT nFlags, CPoint point);
+    afx_msg void OnMButtonUp(UINT nFlags, CPoint point);
     afx_msg void OnDestroy();
     afx_msg void OnTimer(UINT_PTR nIDEvent);
 };
@@ -1260,6 +1260,9 @@ void CDirStatDoc::StartScanningEngine(std::vector<CItem*> items)
     // Stop any previous executions
     StopScanningEngine();
 
+    // Owners are looked up again for the items found
+    CItem::ResetOwners();
+
     // Address currently zoomed / selected item conflicts
     const auto zoomItem = GetZoomItem();
     for (const auto& item : std::vector(items))
@@ -1282,6 +1285,7 @@ void CDirStatDoc::StartScanningEngine(std::vector<CItem*> items)
 
     // Do not attempt to update graph while scanning
     CMainFrame::Get()->GetTreeMapView()->SuspendRecalculationDrawing(true);
+    CMainFrame::Get()->GetTreeMapView()->InvalidateItems(items);
 
     // Start a thread so we do not hang the message loop
     // Lambda captures assume document exists for duration of thread
@@ -1300,11 +1304,12 @@ void CDirStatDoc::StartScanningEngine(std::vector<CItem*> items)
             CFileDupeControl::Get()->RemoveItem(item);
 
             // Record current visual arrangement to reapply afterward
-            if (item->IsVisible())
+            CMainFrame::Get()->InvokeInMessageThread([&]
             {
+                if (!item->IsVisible()) return;
                 visualInfo[item].isSelected = std::ranges::find(selectedItems, item) != selectedItems.end();
                 visualInfo[item].wasExpanded = item->IsExpanded();
-            }
+            });
 
             // Skip pruning if it is a new element
             if (!item->IsDone()) continue;
@@ -1319,8 +1324,11 @@ void CDirStatDoc::StartScanningEngine(std::vector<CItem*> items)
             item->UpwardSetUndone();
 
             // children removal will collapse item so re-expand it
-            if (visualInfo.contains(item) && item->IsVisible())
-                item->SetExpanded(visualInfo[item].wasExpanded);
+            CMainFrame::Get()->InvokeInMessageThread([&]
+            {
+                if (visualInfo.contains(item) && visualInfo[item].wasExpanded && item->IsVisible())
+                    CFileTreeControl::Get()->ExpandItem(item);
+            });
   
             // Handle if item to be refreshed has been removed
             if (item->IsType(IT_FILE | IT_DIRECTORY | IT_DRIVE) &&
@@ -1371,8 +1379,13 @@ void CDirStatDoc::StartScanningEngine(std::vector<CItem*> items)
                     CItem::ScanItems(&queue);
             });
 
+            // Show the treemap of the items found so far while waiting
+            CMainFrame::Get()->GetTreeMapView()->StartProgressiveDrawing(GetZoomItem());
+
             // Wait for all threads to run out of work
-            if (queue.WaitForCompletionOrCancellation())
+            const bool cancelled = queue.WaitForCompletionOrCancellation();
+            CMainFrame::Get()->GetTreeMapView()->StopProgressiveDrawing();
+            if (cancelled)
             {
                 // Exit here and stop progress if drained by an outside actor
                 CMainFrame::Get()->InvokeInMessageThread([]
@@ -1402,9 +1415,12 @@ void CDirStatDoc::StartScanningEngine(std::vector<CItem*> items)
 
         // Sorting and other finalization tasks
         CItem::ScanItemsFinalize(GetRootItem());
+        CFileDupeControl::Get()->ProcessDuplicateFolders(GetRootItem());
+        const ULONGLONG fullReadsAvoided = COptions::ScanForDuplicates ?
+            CFileDupeControl::Get()->GetFullReadsAvoided() : 0;
 
         // Invoke a UI thread to do updates
-        CMainFrame::Get()->InvokeInMessageThread([&items,&visualInfo]
+        CMainFrame::Get()->InvokeInMessageThread([&items,&visualInfo,fullReadsAvoided]
         {
             for (const auto& item : items)
             {
@@ -1421,6 +1437,28 @@ void CDirStatDoc::StartScanningEngine(std::vector<CItem*> items)
             CMainFrame::Get()->RestoreTreeMapView();
             CMainFrame::Get()->GetTreeMapView()->SuspendRecalculationDrawing(false);
             CMainFrame::Get()-> UnlockWindowUpdate();
+
+            // Report what the treemap update, the progressive treemap and the duplicate
+            // sampling cost or saved; the latter once the duplicates found are all shown.
+            // The treemap is drawn right away so that its update is known here.
+            const auto treeMapView = CMainFrame::Get()->GetTreeMapView();
+            treeMapView->UpdateWindow();
+            std::wstring summary = treeMapView->GetUpdateSummary();
+            if (const std::wstring progressive = treeMapView->GetProgressiveSummary(); !progressive.empty())
+            {
+                if (!summary.empty()) summary += L" ";
+                summary += progressive;
+            }
+            if (COptions::ScanForDuplicates)
+            {
+                if (!summary.empty()) summary += L" ";
+                summary += Localization::Format(IDS_DUPLICATES_READS_AVOIDEDs, FormatCount(fullReadsAvoided));
+                CFileDupeControl::Get()->ReportWhenInserted(summary);
+            }
+            else if (!summary.empty())
+            {
+                CMainFrame::Get()->SetMessageText(summary);
+            }
         });
     }).detach();
 }
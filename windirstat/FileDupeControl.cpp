@@ -26,9 +26,15 @@
 #include "ItemDupe.h"
 #include "MainFrame.h"
 #include "FileDupeView.h"
+#include "GlobalHelpers.h"
 #include "Localization.h"
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
 #include <execution>
+#include <format>
+#include <iterator>
 #include <unordered_map>
 #include <ranges>
 #include <stack>
@@ -108,6 +114,9 @@ void CFileDupeControl::OnContextMenu(CWnd* /*pWnd*/, const CPoint pt)
 void CFileDupeControl::ProcessDuplicate(CItem * item, BlockingQueue<CItem*>* queue)
 {
     if (!COptions::ScanForDuplicates) return;
+
+    // Additional hard links share data with a file already being considered
+    if (item->IsType(ITF_HARDLINK)) return;
     if (COptions::SkipDupeDetectionCloudLinks.Obj() &&
         CDirStatApp::Get()->GetReparseInfo()->IsCloudLink(item->GetPathLong(), item->GetAttributes())) return;
 
@@ -124,20 +133,29 @@ void CFileDupeControl::ProcessDuplicate(CItem * item, BlockingQueue<CItem*>* que
     // Add to the list of items to track
     sizeEntry->second.insert(item);
 
+    // Sampling is only worthwhile if it reads notably less than the whole file
+    constexpr auto partialBufferSize = 128ull * 1024ull;
+    const int sampleBlocks = COptions::DupeSampleBlocks;
+    const ULONGLONG sampleBlockSize = static_cast<ULONGLONG>(COptions::DupeSampleBlockSize) * 1024ull;
+    const bool useSampling = sampleBlocks >= 2 &&
+        item->GetSizeLogical() > std::max(partialBufferSize, 2ull * sampleBlocks * sampleBlockSize);
+
     std::wstring hashForThisItem;
     auto itemsToHash = sizeEntry->second;
-    for (const ITEMTYPE & hashType : {ITF_PARTHASH, ITF_FULLHASH })
+    for (const ITEMTYPE & hashType : {ITF_PARTHASH, ITF_SAMPHASH, ITF_FULLHASH })
     {
+        if (hashType == ITF_SAMPHASH && !useSampling) continue;
+
         // Attempt to hash the file partially
-        std::unordered_map<std::wstring, std::unordered_set<CItem*>> hashesToDisplay;
         for (auto& itemToHash : itemsToHash)
         {
             if (itemToHash->IsType(hashType)) continue;
-            constexpr auto partialBufferSize = 128ull * 1024ull;
 
             // Compute the hash for the file
             lock.unlock();
-            std::wstring hash = itemToHash->GetFileHash(hashType == ITF_PARTHASH ? partialBufferSize : 0, queue);
+            std::wstring hash = hashType == ITF_SAMPHASH ?
+                itemToHash->GetFileHashSampled(sampleBlockSize, sampleBlocks, queue) :
+                itemToHash->GetFileHash(hashType == ITF_PARTHASH ? partialBufferSize : 0, queue);
             lock.lock();
 
             itemToHash->SetType(itemToHash->GetRawType() | hashType);
@@ -150,6 +168,9 @@ void CFileDupeControl::ProcessDuplicate(CItem * item, BlockingQueue<CItem*>* que
             if (itemToHash->GetSizeLogical() <= partialBufferSize)
                 itemToHash->SetType(itemToHash->GetRawType() | ITF_FULLHASH);
 
+            // Remember the hash of the whole content for folder fingerprinting
+            if (itemToHash->IsType(ITF_FULLHASH)) m_ContentHashes[itemToHash] = hash;
+
             // See if hash is already in tracking
             const auto hashEntry = m_HashTracker.find(hash);
             if (hashEntry != m_HashTracker.end()) hashEntry->second.insert(itemToHash);
@@ -162,60 +183,386 @@ void CFileDupeControl::ProcessDuplicate(CItem * item, BlockingQueue<CItem*>* que
         itemsToHash = hashesResult->second;
     }
     
+    // Post to the user interface which inserts them in batches
     for (const auto& itemToAdd : itemsToHash)
     {
-        CMainFrame::Get()->InvokeInMessageThread([&]
+        m_FoundDuplicates.Push({ hashForThisItem, itemToAdd });
+    }
+}
+
+void CFileDupeControl::ProcessPendingDuplicates()
+{
+    // The pending items and the visual nodes are only used by the UI thread, so
+    // the scanning threads never wait for the insertion and the sorting below
+    std::ranges::move(m_FoundDuplicates.PopAll(), std::back_inserter(m_PendingDuplicates));
+    if (m_PendingDuplicates.empty())
+    {
+        // Report the finished scan once all of its duplicates are shown
+        if (!m_ReportMessage.has_value()) return;
+
+        std::wstring message = m_ReportMessage.value();
+        if (m_InsertedBatches > 0)
+        {
+            message += L" " + Localization::Format(IDS_DUPLICATES_INSERTEDsss,
+                FormatCount(m_InsertedDuplicates), FormatCount(m_InsertedBatches), m_InsertedMaxTime.count());
+        }
+        CMainFrame::Get()->SetMessageText(message);
+
+        m_ReportMessage.reset();
+        m_InsertedDuplicates = 0;
+        m_InsertedBatches = 0;
+        m_InsertedMaxTime = {};
+        return;
+    }
+
+    // Insert as many items as the frame budget allows and then sort once;
+    // remaining items are inserted next time
+    constexpr auto frameBudget = std::chrono::milliseconds(15);
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto root = reinterpret_cast<CItemDupe*>(GetItem(0));
+    std::size_t processed = 0;
+    while (processed < m_PendingDuplicates.size() &&
+        std::chrono::steady_clock::now() - startTime < frameBudget)
+    {
+        const auto& [hash, itemToAdd] = m_PendingDuplicates[processed++];
+        const auto nodeEntry = m_NodeTracker.find(hash);
+        auto dupeParent = nodeEntry != m_NodeTracker.end() ? nodeEntry->second : nullptr;
+
+        if (dupeParent == nullptr)
+        {
+            // Create new root item to hold these duplicates
+            dupeParent = new CItemDupe(hash, itemToAdd->GetSizePhysical(), itemToAdd->GetSizeLogical());
+            root->AddChild(dupeParent, false);
+            m_NodeTracker.emplace(hash, dupeParent);
+        }
+
+        // See if child is already in list parent
+        const auto& children = dupeParent->GetChildren();
+        if (std::ranges::find_if(children, [itemToAdd](const auto& child)
+            { return child->GetItem() == itemToAdd; }) != children.end()) continue;
+
+        // Add new item
+        dupeParent->AddChild(new CItemDupe(itemToAdd), false);
+    }
+    m_PendingDuplicates.erase(m_PendingDuplicates.begin(), m_PendingDuplicates.begin() +
+        static_cast<std::ptrdiff_t>(processed));
+
+    Sort();
+
+    // Track the time each batch kept the user interface busy
+    m_InsertedDuplicates += processed;
+    m_InsertedBatches++;
+    m_InsertedMaxTime = (std::max)(m_InsertedMaxTime, std::chrono::duration_cast<
+        std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime));
+}
+
+void CFileDupeControl::ReportWhenInserted(const std::wstring& message)
+{
+    m_ReportMessage = message;
+}
+
+void CFileDupeControl::ProcessDuplicateFolders(CItem* root)
+{
+    if (!COptions::ScanForDuplicates || root == nullptr) return;
+
+    // Folders keep their summary and fingerprint until their subtree changes (see
+    // RemoveItem()), so only new folders and the ancestors of refreshed items are
+    // gathered, grouped by depth so they can be processed bottom-up
+    std::shared_lock lock(m_Mutex);
+    std::unordered_map<const CItem*, std::size_t> folderIndex;
+    std::vector<CItem*> folders;
+    std::vector<std::vector<std::size_t>> levels;
+    const auto addFolder = [&](CItem* folder, const std::size_t depth)
+    {
+        if (levels.size() <= depth) levels.resize(depth + 1);
+        levels[depth].push_back(folders.size());
+        folderIndex.emplace(folder, folders.size());
+        folders.push_back(folder);
+    };
+
+    std::stack<std::pair<CItem*, std::size_t>> queue;
+    if (!m_FolderShapes.contains(root)) queue.emplace(root, 0);
+    while (!queue.empty())
+    {
+        const auto [qitem, depth] = queue.top();
+        queue.pop();
+        addFolder(qitem, depth);
+        for (const auto& child : qitem->GetChildren())
+        {
+            if (!child->TmiIsLeaf() && !m_FolderShapes.contains(child)) queue.emplace(child, depth + 1);
+        }
+    }
+    const std::size_t changedFolders = folders.size();
+
+    // Summarize the sizes within each subtree without reading anything; a folder
+    // whose summary is unique cannot have a duplicate and is not fingerprinted
+    const auto combine = [](std::size_t& seed, const ULONGLONG value)
+    {
+        seed ^= std::hash<ULONGLONG>{}(value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+    };
+    std::vector<std::size_t> shapes(folders.size());
+    const auto getShape = [&](CItem* folder)
+    {
+        const auto index = folderIndex.find(folder);
+        return index != folderIndex.end() ? shapes[index->second] : m_FolderShapes.at(folder);
+    };
+    for (const auto& level : std::ranges::reverse_view(levels))
+    {
+        std::for_each(std::execution::par, level.begin(), level.end(), [&](const std::size_t index)
         {
-            const auto root = reinterpret_cast<CItemDupe*>(GetItem(0));
-            const auto nodeEntry = m_NodeTracker.find(hashForThisItem);
-            auto dupeParent = nodeEntry != m_NodeTracker.end() ? nodeEntry->second : nullptr;
+            std::vector<std::pair<ULONGLONG, std::size_t>> entries;
+            for (const auto& child : folders[index]->GetChildren())
+            {
+                entries.emplace_back(child->GetSizeLogical(), child->TmiIsLeaf() ? 0 : getShape(child) | 1);
+            }
+            std::ranges::sort(entries);
+
+            std::size_t shape = entries.size();
+            for (const auto& [size, childShape] : entries)
+            {
+                combine(shape, size);
+                combine(shape, childShape);
+            }
+            shapes[index] = shape;
+        });
+    }
 
-            if (dupeParent == nullptr)
+    std::unordered_map<std::size_t, std::size_t> shapeCounts;
+    for (const auto& shape : m_FolderShapes | std::views::values) shapeCounts[shape]++;
+    for (const auto& shape : shapes) shapeCounts[shape]++;
+
+    // Unchanged folders without a fingerprint are tried again once their summary
+    // is shared or, as files elsewhere were hashed meanwhile, all children are hashed
+    for (const auto& [folder, shape] : m_FolderShapes)
+    {
+        if (m_FolderPrints.contains(folder) || shapeCounts.at(shape) < 2) continue;
+
+        std::size_t depth = 0;
+        for (const CItem* parent = folder->GetParent(); parent != nullptr; parent = parent->GetParent()) depth++;
+        addFolder(folder, depth);
+        shapes.push_back(shape);
+    }
+
+    // Fingerprint the remaining folders from the sorted name, size and hash of
+    // their children; folders with any unhashed file cannot be fingerprinted.
+    // Hard links are represented by the data they link to.
+    static const std::wstring emptyFolder = L"-";
+    std::vector<std::wstring> prints(folders.size());
+    const auto getPrint = [&](CItem* folder) -> const std::wstring*
+    {
+        if (const auto index = folderIndex.find(folder); index != folderIndex.end())
+        {
+            return &prints[index->second];
+        }
+        const auto print = m_FolderPrints.find(folder);
+        return print != m_FolderPrints.end() ? &print->second : nullptr;
+    };
+    for (const auto& level : std::ranges::reverse_view(levels))
+    {
+        std::for_each(std::execution::par, level.begin(), level.end(), [&](const std::size_t index)
+        {
+            const CItem* folder = folders[index];
+            if (folder->GetChildren().empty())
             {
-                // Create new root item to hold these duplicates
-                dupeParent = new CItemDupe(hashForThisItem, itemToAdd->GetSizePhysical(), itemToAdd->GetSizeLogical());
-                root->AddChild(dupeParent);
-                m_NodeTracker.emplace(hashForThisItem, dupeParent);
+                prints[index] = emptyFolder;
+                return;
             }
+            if (shapeCounts.at(shapes[index]) < 2) return;
 
-            // See if child is already in list parent
-            const auto& children = dupeParent->GetChildren();
-            if (std::ranges::find_if(children, [itemToAdd](const auto& child)
-                { return child->GetItem() == itemToAdd; }) != children.end()) return;
+            std::deque<std::wstring> linkHashes;
+            std::vector<std::tuple<std::wstring, ULONGLONG, const std::wstring*>> entries;
+            for (const auto& child : folder->GetChildren())
+            {
+                const std::wstring* hash = nullptr;
+                if (child->IsType(IT_FILE))
+                {
+                    CItem* owner = child->GetHardLinkOwner();
+                    if (const auto contentHash = m_ContentHashes.find(owner != nullptr ? owner : child);
+                        contentHash != m_ContentHashes.end())
+                    {
+                        hash = &contentHash->second;
+                    }
+                    else if (owner != nullptr)
+                    {
+                        // Links to data that was not hashed are only equal to each other
+                        hash = &linkHashes.emplace_back(std::format(L"@{}", static_cast<const void*>(owner)));
+                    }
+                }
+                else if (!child->TmiIsLeaf())
+                {
+                    hash = getPrint(child);
+                }
 
-            // Add new item
-            const auto dupeChild = new CItemDupe(itemToAdd);
-            dupeParent->AddChild(dupeChild);
+                // Unhashed files, folders without fingerprint, free space and unknown items
+                if (hash == nullptr || hash->empty()) return;
 
-            SortItems();
+                entries.emplace_back(child->GetName(), child->GetSizeLogical(), hash);
+            }
+            std::ranges::sort(entries);
+
+            if (!InitializeHashing()) return;
+            for (const auto& [name, size, hash] : entries)
+            {
+                const std::wstring record = std::format(L"{}|{}|{}\n", name, size, *hash);
+                UpdateHashing(reinterpret_cast<const BYTE*>(record.data()),
+                    static_cast<ULONG>(record.size() * sizeof(WCHAR)));
+            }
+            prints[index] = FinishHashing();
         });
     }
+    lock.unlock();
+
+    // Remember the results and group identical folders with files among all of them
+    std::unordered_map<std::wstring, std::vector<CItem*>> groups;
+    std::unique_lock writeLock(m_Mutex);
+    for (std::size_t index = 0; index < folders.size(); index++)
+    {
+        if (index < changedFolders) m_FolderShapes.emplace(folders[index], shapes[index]);
+        if (!prints[index].empty()) m_FolderPrints.emplace(folders[index], std::move(prints[index]));
+    }
+    VTRACE(L"Fingerprinted {} of {} folders", folders.size(), m_FolderShapes.size());
+
+    for (const auto& [folder, print] : m_FolderPrints)
+    {
+        if (!folder->IsType(IT_DIRECTORY) || folder->GetFilesCount() == 0) continue;
+        groups[print].push_back(folder);
+    }
+    std::erase_if(groups, [](const auto& pair)
+    {
+        return pair.second.size() < 2;
+    });
+
+    // Only report the outermost duplicates since nested duplicates are implied
+    std::unordered_set<std::wstring> duplicated;
+    for (const auto& print : groups | std::views::keys) duplicated.insert(print);
+    std::erase_if(groups, [&](const auto& pair)
+    {
+        return std::ranges::all_of(pair.second, [&](const CItem* folder)
+        {
+            const auto parent = m_FolderPrints.find(folder->GetParent());
+            return parent != m_FolderPrints.end() && duplicated.contains(parent->second);
+        });
+    });
+    writeLock.unlock();
+
+    CMainFrame::Get()->InvokeInMessageThread([&]
+    {
+        const auto dupeRoot = reinterpret_cast<CItemDupe*>(GetItem(0));
+        std::vector<CItemDupe*> folderNodes;
+        for (const auto& [print, members] : groups)
+        {
+            const auto dupeParent = new CItemDupe(print, members.front()->GetSizePhysical(),
+                members.front()->GetSizeLogical(), true);
+            dupeRoot->AddChild(dupeParent);
+            for (const auto& member : members)
+            {
+                dupeParent->AddChild(new CItemDupe(member));
+            }
+            folderNodes.push_back(dupeParent);
+        }
+
+        std::unique_lock nodeLock(m_Mutex);
+        m_FolderNodes.insert(m_FolderNodes.end(), folderNodes.begin(), folderNodes.end());
+        nodeLock.unlock();
+
+        SortItems();
+    });
+}
+
+void CFileDupeControl::RemoveDuplicateFolders()
+{
+    std::vector<CItemDupe*> folderNodes;
+    std::unique_lock lock(m_Mutex);
+    std::swap(folderNodes, m_FolderNodes);
+    lock.unlock();
+    if (folderNodes.empty()) return;
+
+    // The user interface may wait for the lock itself, so it is not held here
+    CMainFrame::Get()->InvokeInMessageThread([&]
+    {
+        const auto root = reinterpret_cast<CItemDupe*>(GetItem(0));
+        for (const auto& folderNode : folderNodes)
+        {
+            root->RemoveChild(folderNode);
+        }
+    });
+}
+
+ULONGLONG CFileDupeControl::GetFullReadsAvoided()
+{
+    // Files that were sampled but never needed a full read
+    std::shared_lock lock(m_Mutex);
+    ULONGLONG avoided = 0;
+    for (const auto& items : m_SizeTracker | std::views::values)
+    {
+        avoided += std::ranges::count_if(items, [](const CItem* item)
+        {
+            return item->IsType(ITF_SAMPHASH) && !item->IsType(ITF_FULLHASH);
+        });
+    }
+    return avoided;
+}
+
+// A link which takes over the data of a removed file was skipped as an additional
+// link so far. It is tracked by its size from now on and hashed with the next file of
+// the same size; the folders above it are fingerprinted again.
+void CFileDupeControl::TrackPromotedLinks(const std::vector<CItem*>& links)
+{
+    if (!COptions::ScanForDuplicates || links.empty()) return;
+
+    std::unique_lock lock(m_Mutex);
+    for (CItem* link : links)
+    {
+        m_SizeTracker[link->GetSizeLogical()].insert(link);
+        for (CItem* parent = link->GetParent(); parent != nullptr; parent = parent->GetParent())
+        {
+            m_FolderShapes.erase(parent);
+            m_FolderPrints.erase(parent);
+        }
+    }
 }
 
 void CFileDupeControl::RemoveItem(CItem* item)
 {
-    // Exit immediately if not doing duplicate detector
-    if (m_HashTracker.empty() && m_SizeTracker.empty()) return;
+    // Folder groups are recomputed once scanning completes
+    RemoveDuplicateFolders();
+
+    // The folders above the item are fingerprinted again when scanning completes
+    std::unique_lock lock(m_Mutex);
+    for (CItem* parent = item->GetParent(); parent != nullptr; parent = parent->GetParent())
+    {
+        m_FolderShapes.erase(parent);
+        m_FolderPrints.erase(parent);
+    }
 
     std::stack<CItem*> queue({ item });
     std::unordered_set<CItem*> itemsToRemove;
     while (!queue.empty())
     {
-        const auto& qitem = queue.top();
+        const auto qitem = queue.top();
         queue.pop();
         if (qitem->IsType(IT_FILE)) itemsToRemove.emplace(qitem);
-        else for (const auto& child : qitem->GetChildren())
+        else
         {
-            queue.push(child);
+            m_FolderShapes.erase(qitem);
+            m_FolderPrints.erase(qitem);
+            for (const auto& child : qitem->GetChildren())
+            {
+                queue.push(child);
+            }
         }
     }
 
-    const auto root = reinterpret_cast<CItemDupe*>(GetItem(0));
+    // Exit immediately if not doing duplicate detector
+    if (m_HashTracker.empty() && m_SizeTracker.empty()) return;
+
+    std::unordered_set<std::wstring> changedHashes;
     for (const auto& itemToRemove : std::ranges::reverse_view(itemsToRemove))
     {
-        // Remove from size tracker
-        const auto size = itemToRemove->GetSizeLogical();
-        m_SizeTracker.at(size).erase(itemToRemove);
+        // Remove from size tracker, which never held additional hard links
+        const auto sizeEntry = m_SizeTracker.find(itemToRemove->GetSizeLogical());
+        if (sizeEntry != m_SizeTracker.end()) sizeEntry->second.erase(itemToRemove);
+        m_ContentHashes.erase(itemToRemove);
 
         // Remove from hash tracker
         for (auto& [hashKey, hashSet] : m_HashTracker)
@@ -226,14 +573,46 @@ void CFileDupeControl::RemoveItem(CItem* item)
             // Remove from this set
             hashSet.erase(itemToRemove);
 
-            // Continue if this is not present in the node list
-            if (!m_NodeTracker.contains(hashKey)) continue;
+            // Remember to update the visual node list and the posted duplicates
+            changedHashes.insert(hashKey);
+        }
+    }
+
+    // Cleanup empty structures
+    std::erase_if(m_HashTracker, [&](const auto& pair)
+    {
+        return pair.second.empty();
+    });
+    std::erase_if(m_SizeTracker, [&](const auto& pair)
+    {
+        return pair.second.empty();
+    });
+    lock.unlock();
+    if (changedHashes.empty()) return;
 
-            // Remove the entry from the visual node list
-            auto& hashNode = m_NodeTracker.at(hashKey);
+    // The visual nodes are updated by the user interface, which may wait for
+    // the lock itself (see ProcessDuplicateFolders()), so it must not be held
+    // while waiting for the user interface
+    CMainFrame::Get()->InvokeInMessageThread([&]
+    {
+        // Duplicates posted but not inserted yet are dropped with the items
+        std::ranges::move(m_FoundDuplicates.PopAll(), std::back_inserter(m_PendingDuplicates));
+        std::erase_if(m_PendingDuplicates, [&](const auto& pending)
+        {
+            return itemsToRemove.contains(pending.second);
+        });
+
+        const auto root = reinterpret_cast<CItemDupe*>(GetItem(0));
+        for (const auto& hashKey : changedHashes)
+        {
+            const auto nodeEntry = m_NodeTracker.find(hashKey);
+            if (nodeEntry == m_NodeTracker.end()) continue;
+
+            // Remove the entries from the visual node list
+            const auto hashNode = nodeEntry->second;
             for (auto& dupeChild : std::vector(hashNode->GetChildren()))
             {
-                if (dupeChild->GetItem() == itemToRemove)
+                if (itemsToRemove.contains(dupeChild->GetItem()))
                 {
                     hashNode->RemoveChild(dupeChild);
                 }
@@ -243,19 +622,9 @@ void CFileDupeControl::RemoveItem(CItem* item)
             if (hashNode->GetChildren().size() <= 1)
             {
                 root->RemoveChild(hashNode);
-                m_NodeTracker.erase(hashKey);
+                m_NodeTracker.erase(nodeEntry);
             }
         }
-    }
-
-    // Cleanup empty structures
-    std::erase_if(m_HashTracker, [&](const auto& pair)
-    {
-        return pair.second.empty();
-    });
-    std::erase_if(m_SizeTracker, [&](const auto& pair)
-    {
-        return pair.second.empty();
     });
 }
 
@@ -297,7 +666,7 @@ void CFileDupeControl::OnLvnItemchangingList(NMHDR* pNMHDR, LRESULT* pResult)
         (pNMLV->uOldState & LVIS_SELECTED) == 0 &&
         (pNMLV->uNewState & LVIS_SELECTED) != 0;
 
-    if (requestingSelection && reinterpret_cast<CItemDupe*>(GetItem(pNMLV->iItem))->GetItem() == nullptr)
+    if (requestingSelection && pNMLV->iItem >= 0 && reinterpret_cast<CItemDupe*>(GetItem(pNMLV->iItem))->GetItem() == nullptr)
     {
         *pResult = TRUE;
         return;
@@ -306,17 +675,21 @@ void CFileDupeControl::OnLvnItemchangingList(NMHDR* pNMHDR, LRESULT* pResult)
     return CTreeListControl::OnLvnItemchangingList(pNMHDR, pResult);
 }
 
-void CFileDupeControl::InsertItem(const int i, CTreeListItem* item)
-{
-    InsertListItem(i, item);
-    item->SetVisible(this, true);
-}
-
 void CFileDupeControl::SetRootItem(CTreeListItem* root)
 {
     m_NodeTracker.clear();
     m_HashTracker.clear();
     m_SizeTracker.clear();
+    m_ContentHashes.clear();
+    m_FolderShapes.clear();
+    m_FolderPrints.clear();
+    m_FolderNodes.clear();
+    m_PendingDuplicates.clear();
+    (void) m_FoundDuplicates.PopAll();
+    m_ReportMessage.reset();
+    m_InsertedDuplicates = 0;
+    m_InsertedBatches = 0;
+    m_InsertedMaxTime = {};
 
     CTreeListControl::SetRootItem(root);
 }
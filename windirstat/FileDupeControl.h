@@ -22,8 +22,11 @@
 #pragma once
 
 #include "ItemDupe.h"
+#include "LockFreeQueue.h"
 #include "TreeListControl.h"
 
+#include <chrono>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 #include <shared_mutex>
@@ -34,15 +37,32 @@ public:
     CFileDupeControl();
     bool GetAscendingDefault(int column) override;
     static CFileDupeControl* Get() { return m_Singleton; }
-    void InsertItem(int i, CTreeListItem* item);
     void SetRootItem(CTreeListItem* root) override;
     void ProcessDuplicate(CItem* item, BlockingQueue<CItem*>* queue);
+    void ProcessDuplicateFolders(CItem* root);
+    void ProcessPendingDuplicates();
+    void ReportWhenInserted(const std::wstring& message);
+    void RemoveDuplicateFolders();
     void RemoveItem(CItem* items);
+    void TrackPromotedLinks(const std::vector<CItem*>& links);
+    ULONGLONG GetFullReadsAvoided();
 
     std::shared_mutex m_Mutex;
     std::unordered_map<ULONGLONG, std::unordered_set<CItem*>> m_SizeTracker;
-    std::unordered_map<std::wstring, CItemDupe*> m_NodeTracker;
+    std::unordered_map<std::wstring, CItemDupe*> m_NodeTracker; // Only used by the UI thread
     std::unordered_map<std::wstring, std::unordered_set<CItem*>> m_HashTracker;
+    std::unordered_map<CItem*, std::wstring> m_ContentHashes;
+    std::unordered_map<CItem*, std::size_t> m_FolderShapes;
+    std::unordered_map<CItem*, std::wstring> m_FolderPrints;
+    std::vector<CItemDupe*> m_FolderNodes;
+    LockFreeQueue<std::pair<std::wstring, CItem*>> m_FoundDuplicates; // Posted by the scanning threads
+    std::vector<std::pair<std::wstring, CItem*>> m_PendingDuplicates;  // Not inserted yet, only used by the UI thread
+
+    // Insertion statistics reported in the status bar, only used by the UI thread
+    std::optional<std::wstring> m_ReportMessage;
+    std::size_t m_InsertedDuplicates = 0;
+    std::size_t m_InsertedBatches = 0;
+    std::chrono::milliseconds m_InsertedMaxTime{};
 
     template <class T = CTreeListItem> std::vector<T*> GetAllSelected()
     {
@@ -55,6 +55,7 @@ BEGIN_MESSAGE_MAP(CFileDupeView, CView)
     ON_WM_SETFOCUS()
     ON_WM_SETTINGCHANGE()
     ON_NOTIFY(LVN_ITEMCHANGED, ID_WDS_CONTROL, OnLvnItemchanged)
+    ON_NOTIFY(LVN_ODSTATECHANGED, ID_WDS_CONTROL, OnLvnOdstatechanged)
     ON_UPDATE_COMMAND_UI(ID_POPUP_TOGGLE, OnUpdatePopupToggle)
     ON_COMMAND(ID_POPUP_TOGGLE, OnPopupToggle)
 END_MESSAGE_MAP()
@@ -140,6 +141,22 @@ void CFileDupeView::OnLvnItemchanged(NMHDR* pNMHDR, LRESULT* pResult)
     *pResult = FALSE;
 }
 
+void CFileDupeView::OnLvnOdstatechanged(NMHDR* pNMHDR, LRESULT* pResult)
+{
+    const auto pStateChange = reinterpret_cast<LPNMLVODSTATECHANGE>(pNMHDR);
+
+    // only process selection changes of a range of rows
+    if (((pStateChange->uOldState ^ pStateChange->uNewState) & LVIS_SELECTED) == 0)
+    {
+        return;
+    }
+
+    // Signal to listeners that selection has changed
+    GetDocument()->UpdateAllViews(this, HINT_SELECTIONREFRESH);
+
+    *pResult = FALSE;
+}
+
 void CFileDupeView::OnUpdate(CView* pSender, const LPARAM lHint, CObject* pHint)
 {
     ASSERT(AfxGetThread() != nullptr);
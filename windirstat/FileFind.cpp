@@ -53,16 +53,26 @@ bool FileFindEnhanced::FindNextFile()
         uSearch.MaximumLength = static_cast<USHORT>(m_Search.size() + 1) * sizeof(WCHAR);
         uSearch.Buffer = m_Search.data();
 
-        // enumerate files in the directory
-        constexpr auto FileDirectoryInformation = 1;
+        // enumerate files in the directory; the file identifiers are requested so
+        // hard links can be recognized but not all file systems provide them
+        constexpr auto StatusInvalidInfoClass = static_cast<NTSTATUS>(0xC0000003L);
+        constexpr auto StatusNotSupported = static_cast<NTSTATUS>(0xC00000BBL);
         IO_STATUS_BLOCK IoStatusBlock;
-        const NTSTATUS Status = NtQueryDirectoryFile(m_Handle, nullptr, nullptr, nullptr, &IoStatusBlock,
-            m_DirectoryInfo.data(), BUFFER_SIZE, static_cast<FILE_INFORMATION_CLASS>(FileDirectoryInformation),
+        NTSTATUS Status = NtQueryDirectoryFile(m_Handle, nullptr, nullptr, nullptr, &IoStatusBlock,
+            m_DirectoryInfo.data(), BUFFER_SIZE, static_cast<FILE_INFORMATION_CLASS>(m_InfoClass),
             FALSE, (uSearch.Length > 0) ? &uSearch : nullptr, (m_Firstrun) ? TRUE : FALSE);
+        if (m_Firstrun && m_InfoClass == FileIdFullDirectoryInformation &&
+            (Status == StatusInvalidInfoClass || Status == StatusNotSupported))
+        {
+            m_InfoClass = FileDirectoryInformation;
+            Status = NtQueryDirectoryFile(m_Handle, nullptr, nullptr, nullptr, &IoStatusBlock,
+                m_DirectoryInfo.data(), BUFFER_SIZE, static_cast<FILE_INFORMATION_CLASS>(m_InfoClass),
+                FALSE, (uSearch.Length > 0) ? &uSearch : nullptr, TRUE);
+        }
 
         // fetch point to current node 
         success = (Status == 0);
-        m_CurrentInfo = reinterpret_cast<FILE_DIRECTORY_INFORMATION*>(m_DirectoryInfo.data());
+        m_CurrentInfo = reinterpret_cast<FILE_ID_FULL_DIR_INFORMATION*>(m_DirectoryInfo.data());
 
         // special case for reparse on initial run points - update attributes
         if (success && m_Firstrun) m_CurrentInfo->FileAttributes = GetFileAttributes(GetFilePathLong().c_str());
@@ -72,15 +82,17 @@ bool FileFindEnhanced::FindNextFile()
     }
     else
     {
-        m_CurrentInfo = reinterpret_cast<FILE_DIRECTORY_INFORMATION*>(
+        m_CurrentInfo = reinterpret_cast<FILE_ID_FULL_DIR_INFORMATION*>(
             &reinterpret_cast<BYTE*>(m_CurrentInfo)[m_CurrentInfo->NextEntryOffset]);
         success = true;
     }
 
     if (success)
     {
+        const WCHAR* name = (m_InfoClass == FileIdFullDirectoryInformation) ? m_CurrentInfo->FileName :
+            reinterpret_cast<FILE_DIRECTORY_INFORMATION*>(m_CurrentInfo)->FileName;
         m_Name.resize(m_CurrentInfo->FileNameLength / sizeof(WCHAR));
-        memcpy(m_Name.data(), m_CurrentInfo->FileName, m_CurrentInfo->FileNameLength);
+        memcpy(m_Name.data(), name, m_CurrentInfo->FileNameLength);
     }
 
     return success;
@@ -177,6 +189,29 @@ FILETIME FileFindEnhanced::GetLastWriteTime() const
         static_cast<DWORD>(m_CurrentInfo->LastWriteTime.HighPart) };
 }
 
+ULONGLONG FileFindEnhanced::GetFileId() const
+{
+    // zero indicates the file system did not provide an identifier
+    return (m_InfoClass == FileIdFullDirectoryInformation) ? m_CurrentInfo->FileId.QuadPart : 0;
+}
+
+DWORD FileFindEnhanced::GetReparseTag() const
+{
+    // for reparse points the file system reports the tag in place of the extended attribute size
+    if ((m_CurrentInfo->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0) return 0;
+    return (m_InfoClass == FileIdFullDirectoryInformation) ? m_CurrentInfo->EaSize : 0;
+}
+
+DWORD FileFindEnhanced::GetVolumeSerial() const
+{
+    // only queried on demand since it is only needed for hard link tracking
+    if (m_VolumeSerial == 0)
+    {
+        GetVolumeInformationByHandleW(m_Handle, nullptr, 0, &m_VolumeSerial, nullptr, nullptr, nullptr, 0);
+    }
+    return m_VolumeSerial;
+}
+
 std::wstring FileFindEnhanced::GetFilePath() const
 {
     // Get full path to folder or file
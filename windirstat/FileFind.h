@@ -40,12 +40,33 @@ class FileFindEnhanced final
         WCHAR         FileName[1];
     };
 
+    using FILE_ID_FULL_DIR_INFORMATION = struct {
+        ULONG         NextEntryOffset;
+        ULONG         FileIndex;
+        LARGE_INTEGER CreationTime;
+        LARGE_INTEGER LastAccessTime;
+        LARGE_INTEGER LastWriteTime;
+        LARGE_INTEGER ChangeTime;
+        LARGE_INTEGER EndOfFile;
+        LARGE_INTEGER AllocationSize;
+        ULONG         FileAttributes;
+        ULONG         FileNameLength;
+        ULONG         EaSize;
+        LARGE_INTEGER FileId;
+        WCHAR         FileName[1];
+    };
+
+    static constexpr auto FileDirectoryInformation = 1;
+    static constexpr auto FileIdFullDirectoryInformation = 38;
+
     std::wstring m_Search;
     std::wstring m_Base;
     std::wstring m_Name;
     HANDLE m_Handle = nullptr;
     bool m_Firstrun = true;
-    FILE_DIRECTORY_INFORMATION* m_CurrentInfo = nullptr;
+    int m_InfoClass = FileIdFullDirectoryInformation;
+    mutable DWORD m_VolumeSerial = 0;
+    FILE_ID_FULL_DIR_INFORMATION* m_CurrentInfo = nullptr;
     static constexpr auto m_Dos = L"\\??\\";
     static constexpr auto m_DosUNC = L"\\??\\UNC\\";
     static constexpr auto m_Long = L"\\\\?\\";
@@ -69,6 +90,9 @@ public:
     ULONGLONG GetFileSizePhysical() const;
     ULONGLONG GetFileSizeLogical() const;
     FILETIME GetLastWriteTime() const;
+    ULONGLONG GetFileId() const;
+    DWORD GetReparseTag() const;
+    DWORD GetVolumeSerial() const;
     std::wstring GetFilePath() const;
     std::wstring GetFilePathLong() const;
     static bool DoesFileExist(const std::wstring& folder, const std::wstring& file = {});
@@ -55,6 +55,7 @@ protected:
     afx_msg void OnSetFocus(CWnd* pOldWnd);
     afx_msg void OnSettingChange(UINT uFlags, LPCWSTR lpszSection);
     afx_msg void OnLvnItemchanged(NMHDR* pNMHDR, LRESULT* pResult);
+    afx_msg void OnLvnOdstatechanged(NMHDR* pNMHDR, LRESULT* pResult);
     afx_msg void OnUpdatePopupToggle(CCmdUI* pCmdUI);
     afx_msg void OnPopupToggle();
 };
@@ -57,6 +57,11 @@ namespace
 
         return all;
     }
+
+    // Hashing state which is reused for everything hashed on this thread
+    thread_local std::vector<BYTE> Hash;
+    thread_local SmartPointer<BCRYPT_HASH_HANDLE> HashHandle(BCryptDestroyHash);
+    thread_local DWORD HashLength = 0;
 }
 
 std::wstring GetLocaleString(const LCTYPE lctype, const LANGID langid)
@@ -644,3 +649,72 @@ const std::wstring & GetSysDirectory()
     s.resize(wcslen(s.data()));
     return s;
 }
+
+bool InitializeHashing()
+{
+    if (HashLength != 0) return true;
+
+    BCRYPT_ALG_HANDLE AlgHandle = nullptr;
+    DWORD ResultLength = 0;
+    if (BCryptOpenAlgorithmProvider(&AlgHandle, BCRYPT_SHA256_ALGORITHM, MS_PRIMITIVE_PROVIDER, BCRYPT_HASH_REUSABLE_FLAG) != 0 ||
+        BCryptGetProperty(AlgHandle, BCRYPT_HASH_LENGTH, reinterpret_cast<PBYTE>(&HashLength), sizeof(HashLength), &ResultLength, 0) != 0 ||
+        BCryptCreateHash(AlgHandle, &HashHandle, nullptr, 0, nullptr, 0, BCRYPT_HASH_REUSABLE_FLAG) != 0)
+    {
+        HashLength = 0;
+        return false;
+    }
+
+    Hash.resize(HashLength);
+    return true;
+}
+
+bool UpdateHashing(const BYTE* data, const ULONG size)
+{
+    return BCryptHashData(HashHandle, const_cast<PUCHAR>(data), size, 0) == 0;
+}
+
+std::wstring FinishHashing()
+{
+    // Finishing also resets the reusable hash for the next use
+    if (BCryptFinishHash(HashHandle, Hash.data(), HashLength, 0) != 0)
+    {
+        return {};
+    }
+
+    // Convert to hex string
+    std::wstring sHash;
+    sHash.resize(2ull * HashLength);
+    DWORD iHashStringLength = static_cast<DWORD>(sHash.size() + 1ull);
+    CryptBinaryToStringW(Hash.data(), HashLength, CRYPT_STRING_HEXRAW | CRYPT_STRING_NOCRLF,
+        sHash.data(), &iHashStringLength);
+    return sHash;
+}
+
+// Writes text to the standard output or, if there is none, to the console
+// the application was started from
+void WriteCommandOutput(const std::wstring& text)
+{
+    static HANDLE output = []
+    {
+        HANDLE handle = ::GetStdHandle(STD_OUTPUT_HANDLE);
+        if ((handle == nullptr || handle == INVALID_HANDLE_VALUE) && ::AttachConsole(ATTACH_PARENT_PROCESS))
+        {
+            handle = ::CreateFile(L"CONOUT$", GENERIC_WRITE, FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+        }
+        return handle;
+    }();
+
+    if (output == nullptr || output == INVALID_HANDLE_VALUE) return;
+
+    const int size = ::WideCharToMultiByte(CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), nullptr, 0, nullptr, nullptr);
+    std::string utf8(size, '\0');
+    ::WideCharToMultiByte(CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), utf8.data(), size, nullptr, nullptr);
+    DWORD written;
+    ::WriteFile(output, utf8.data(), static_cast<DWORD>(utf8.size()), &written, nullptr);
+}
+
+// Returns the positive number at index of the command line or fallback if there is none
+int ParseCommandInt(const std::vector<std::wstring>& args, const std::size_t index, const int fallback)
+{
+    return index < args.size() ? max(_wtoi(args[index].c_str()), 1) : fallback;
+}
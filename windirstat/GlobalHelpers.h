@@ -24,6 +24,7 @@
 
 #include <string>
 #include <ranges>
+#include <vector>
 
 std::wstring GetLocaleString(LCTYPE lctype, LANGID langid);
 std::wstring GetLocaleLanguage(LANGID langid);
@@ -62,3 +63,8 @@ void ReplaceString(std::wstring& subject, const std::wstring& search, const std:
 std::wstring& TrimString(std::wstring& s, wchar_t c = L' ');
 std::wstring& MakeLower(std::wstring& s);
 const std::wstring& GetSysDirectory();
+bool InitializeHashing();
+bool UpdateHashing(const BYTE* data, ULONG size);
+std::wstring FinishHashing();
+void WriteCommandOutput(const std::wstring& text);
+int ParseCommandInt(const std::vector<std::wstring>& args, std::size_t index, int fallback);
@@ -30,6 +30,7 @@
 #include "GlobalHelpers.h"
 #include "SelectObject.h"
 #include "Item.h"
+#include "TreeMapLayout.h"
 #include "BlockingQueue.h"
 #include "Localization.h"
 #include "SmartPointer.h"
@@ -37,11 +38,235 @@
 #include <string>
 #include <algorithm>
 #include <unordered_set>
+#include <unordered_map>
+#include <format>
 #include <functional>
 #include <queue>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <shared_mutex>
 #include <stack>
 #include <array>
+#include <limits>
+
+namespace
+{
+    // Files are identified by the volume they reside on and their file identifier;
+    // multiple directory entries with the same identity are hard links
+    struct FILEIDENTITY
+    {
+        DWORD volume;
+        ULONGLONG id;
+        bool operator==(const FILEIDENTITY&) const = default;
+    };
+
+    struct FILEIDENTITYHASH
+    {
+        std::size_t operator()(const FILEIDENTITY& identity) const
+        {
+            return std::hash<ULONGLONG>{}(identity.id ^ (static_cast<ULONGLONG>(identity.volume) << 32));
+        }
+    };
+
+    // Hard links are tracked in shards, so that scanning threads rarely wait for
+    // each other: files by the hash of their identity and items, which are mapped
+    // back to their identity, by the hash of their address. The first link seen
+    // owns the data; further links are kept to take over when it is deleted.
+    constexpr auto HARDLINK_SHARD_BITS = 6;
+    struct HARDLINKOWNER
+    {
+        CItem* item;
+        ULONGLONG sizePhysical; // Of the data, as the item itself may have been emptied
+    };
+    struct HARDLINKSHARD
+    {
+        std::mutex lock;
+        std::unordered_map<FILEIDENTITY, HARDLINKOWNER, FILEIDENTITYHASH> owners;
+        std::unordered_multimap<FILEIDENTITY, CItem*, FILEIDENTITYHASH> links;
+        std::unordered_map<const CItem*, FILEIDENTITY> identities;
+    };
+
+    std::array<HARDLINKSHARD, 1 << HARDLINK_SHARD_BITS> HardLinkShards;
+    std::atomic<ULONGLONG> HardLinksTracked = 0;
+
+    // The top bits select the shard since the tables within use the low bits
+    HARDLINKSHARD& GetHardLinkShard(const std::size_t hash)
+    {
+        return HardLinkShards[hash >> (std::numeric_limits<std::size_t>::digits - HARDLINK_SHARD_BITS)];
+    }
+
+    // Every extension is stored once; items point into this set, so the
+    // pointer can be used to identify an extension
+    std::shared_mutex ExtensionLock;
+    std::unordered_set<std::wstring> Extensions;
+
+    // Owner SIDs collected while scanning are stored once; items refer to them
+    // by their index, with the first entry reserved for items without one
+    std::shared_mutex OwnerSidLock;
+    std::vector<std::vector<BYTE>> OwnerSids(1);
+    std::map<std::vector<BYTE>, unsigned short> OwnerSidIndices;
+
+    // Reading security descriptors and looking up account names can take long,
+    // so owners shown in the file tree are resolved by a few background threads;
+    // results are keyed by path so they outlive any item that requested them,
+    // until the next scan starts (see ResetOwners())
+    constexpr auto OWNER_THREADS = 4;
+    struct OWNERREQUEST
+    {
+        std::wstring path;
+        std::vector<BYTE> sid;
+        ULONG generation;
+    };
+
+    std::mutex OwnerLock;
+    std::condition_variable_any OwnerRequested;
+    std::deque<OWNERREQUEST> OwnerRequests;
+    std::unordered_set<std::wstring> OwnersPending;
+    std::unordered_map<std::wstring, std::wstring> OwnersResolved;
+    std::atomic<bool> OwnersChanged = false;
+    ULONG OwnersGeneration = 0;
+    std::vector<std::jthread> OwnerThreads;
+
+    std::vector<BYTE> ReadOwnerSid(const std::wstring& path)
+    {
+        SmartPointer<PSECURITY_DESCRIPTOR> ps(LocalFree);
+        PSID sid = nullptr;
+        if (GetNamedSecurityInfo(path.c_str(), SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION,
+            &sid, nullptr, nullptr, nullptr, &ps) != ERROR_SUCCESS || sid == nullptr) return {};
+
+        const auto bytes = static_cast<BYTE*>(sid);
+        return { bytes, bytes + GetLengthSid(sid) };
+    }
+
+    unsigned short RegisterOwnerSid(const std::wstring& path)
+    {
+        std::vector<BYTE> sid = ReadOwnerSid(path);
+        if (sid.empty()) return 0;
+
+        {
+            std::shared_lock lock(OwnerSidLock);
+            if (const auto index = OwnerSidIndices.find(sid); index != OwnerSidIndices.end()) return index->second;
+        }
+
+        std::lock_guard lock(OwnerSidLock);
+        if (const auto index = OwnerSidIndices.find(sid); index != OwnerSidIndices.end()) return index->second;
+        if (OwnerSids.size() > USHRT_MAX) return 0;
+
+        const auto index = static_cast<unsigned short>(OwnerSids.size());
+        OwnerSidIndices.emplace(sid, index);
+        OwnerSids.emplace_back(std::move(sid));
+        return index;
+    }
+
+    std::vector<BYTE> GetOwnerSid(const unsigned short index)
+    {
+        if (index == 0) return {};
+        std::shared_lock lock(OwnerSidLock);
+        return OwnerSids[index];
+    }
+
+    std::wstring ResolveOwner(const std::wstring& path, std::vector<BYTE> sid)
+    {
+        if (sid.empty()) sid = ReadOwnerSid(path);
+        return sid.empty() ? std::wstring() : GetNameFromSid(sid.data());
+    }
+
+    void ResolveOwners(const std::stop_token& stop)
+    {
+        while (true)
+        {
+            OWNERREQUEST request;
+            {
+                std::unique_lock lock(OwnerLock);
+                if (!OwnerRequested.wait(lock, stop, [] { return !OwnerRequests.empty(); })) return;
+                request = std::move(OwnerRequests.front());
+                OwnerRequests.pop_front();
+            }
+
+            std::wstring owner = ResolveOwner(request.path, std::move(request.sid));
+            std::lock_guard lock(OwnerLock);
+            if (request.generation != OwnersGeneration) continue;
+            OwnersResolved.insert_or_assign(std::move(request.path), std::move(owner));
+            OwnersChanged = true;
+        }
+    }
+
+    short GetLinkImage(const DWORD attr)
+    {
+        constexpr DWORD mask = FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM;
+        const bool osFile = (attr & mask) == mask;
+        return osFile ? GetIconImageList()->GetJunctionProtectedImage() : GetIconImageList()->GetJunctionImage();
+    }
+
+    // Looks up the image of an item that has to be inspected on disk
+    short ResolveImage(const std::wstring& path, const DWORD attr)
+    {
+        const std::wstring longpath = FileFindEnhanced::MakeLongPathCompatible(path);
+        if (CDirStatApp::Get()->GetReparseInfo()->IsVolumeMountPoint(longpath, attr))
+        {
+            return GetIconImageList()->GetMountPointImage();
+        }
+        if (CDirStatApp::Get()->GetReparseInfo()->IsSymbolicLink(longpath, attr) ||
+            CDirStatApp::Get()->GetReparseInfo()->IsJunction(longpath, attr))
+        {
+            return GetLinkImage(attr);
+        }
+
+        return GetIconImageList()->GetFileImage(path, attr);
+    }
+
+    // Progress of a scanning thread: the steps taken (entries read and buffers
+    // hashed) and the item being scanned; the UI timer samples these instead of
+    // the threads updating the animation of every ancestor themselves
+    struct alignas(64) SCANPROGRESS
+    {
+        std::atomic<ULONGLONG> steps = 0;
+        std::atomic<CItem*> item = nullptr;
+        std::atomic<bool> used = false;
+        ULONGLONG sampled = 0; // Steps seen by the last sample, only used by the UI thread
+    };
+
+    // Slots are reused by later threads and never freed, so their addresses are stable
+    std::mutex ScanProgressLock;
+    std::deque<SCANPROGRESS> ScanProgress;
+
+    SCANPROGRESS& GetScanProgress()
+    {
+        thread_local const struct SLOT
+        {
+            SCANPROGRESS* progress = nullptr;
+
+            SLOT()
+            {
+                std::lock_guard lock(ScanProgressLock);
+                const auto unused = std::ranges::find_if(ScanProgress, [](const SCANPROGRESS& slot) { return !slot.used; });
+                progress = unused != ScanProgress.end() ? &*unused : &ScanProgress.emplace_back();
+                progress->used = true;
+            }
+
+            ~SLOT()
+            {
+                progress->item = nullptr;
+                progress->used = false;
+            }
+        } slot;
+        return *slot.progress;
+    }
+
+    // Buffers used for overlapped reads while hashing; the data of one buffer is
+    // hashed while the remaining buffers are being filled by the file system
+    struct HASHREAD
+    {
+        std::vector<BYTE> buffer;
+        OVERLAPPED overlapped = {};
+        SmartPointer<HANDLE> event{ CloseHandle, CreateEvent(nullptr, TRUE, FALSE, nullptr) };
+        DWORD requested = 0;
+        bool pending = false;
+    };
+}
 
 CItem::CItem(const ITEMTYPE type, const std::wstring & name) : m_Name(name), m_Type(type)
 {
@@ -57,10 +282,8 @@ CItem::CItem(const ITEMTYPE type, const std::wstring & name) : m_Name(name), m_T
             std::wstring extToAdd(&ext[0]);
             _wcslwr_s(extToAdd.data(), extToAdd.size() + 1);
 
-            static std::shared_mutex extLock;
-            static std::unordered_set<std::wstring> extcache;
-            std::lock_guard lock(extLock);
-            const auto cached = extcache.insert(std::move(extToAdd));
+            std::lock_guard lock(ExtensionLock);
+            const auto cached = Extensions.insert(std::move(extToAdd));
             m_Extension = cached.first->c_str();
         }
         else
@@ -93,6 +316,8 @@ CItem::CItem(const ITEMTYPE type, const std::wstring& name, const FILETIME lastC
 
 CItem::~CItem()
 {
+    if (IsType(IT_FILE)) UntrackHardLink(false);
+
     if (m_FolderInfo != nullptr)
     {
         for (const auto& m_Child : m_FolderInfo->m_Children)
@@ -113,6 +338,9 @@ void CItem::TmiSetRectangle(const CRect& rc)
     m_Rect = rc;
 }
 
+// The treemap layout is instantiated here for TreeMapAccess, so that CTreeMap need not know CItem
+template void CTreeMap::RecurseLayout<CItem::TreeMapAccess>(Item* item, const CRect& rc, int parent);
+
 bool CItem::DrawSubitem(const int subitem, CDC* pdc, CRect rc, const UINT state, int* width, int* focusLeft) const
 {
     if (subitem == COL_NAME)
@@ -357,15 +585,101 @@ int CItem::CompareSibling(const CTreeListItem* tlib, const int subitem) const
     }
 }
 
+CTreeListItem::SORTKEY CItem::GetSortKey(const int subitem) const
+{
+    // Same order as CompareSibling()
+    switch (subitem)
+    {
+        case COL_NAME:
+        {
+            return SORTKEY::FromText(IsType(IT_DRIVE) ? GetPath() : m_Name);
+        }
+
+        case COL_SUBTREEPERCENTAGE:
+        {
+            if (MustShowReadJobs())
+            {
+                return { GetReadJobs() };
+            }
+            return { GetSizePhysical() };
+        }
+
+        case COL_PERCENTAGE:
+        case COL_SIZE_PHYSICAL:
+        {
+            // The fractions of the parent size are ordered like the sizes
+            return { GetSizePhysical() };
+        }
+
+        case COL_SIZE_LOGICAL:
+        {
+            return { GetSizeLogical() };
+        }
+
+        case COL_ITEMS:
+        {
+            return { GetItemsCount() };
+        }
+
+        case COL_FILES:
+        {
+            return { GetFilesCount() };
+        }
+
+        case COL_FOLDERS:
+        {
+            return { GetFoldersCount() };
+        }
+
+        case COL_LASTCHANGE:
+        {
+            return { static_cast<ULONGLONG>(m_LastChange.dwHighDateTime) << 32 | m_LastChange.dwLowDateTime };
+        }
+
+        case COL_ATTRIBUTES:
+        {
+            return { GetSortAttributes() };
+        }
+
+        case COL_OWNER:
+        {
+            // Owners still being resolved sort as empty
+            return SORTKEY::FromText(RequestOwner().value_or(L""));
+        }
+
+        default:
+        {
+            return {};
+        }
+    }
+}
+
+// The tree list reads the children while scanning threads may add to them
 int CItem::GetTreeListChildCount() const
 {
     if (m_FolderInfo == nullptr) return 0;
-    return static_cast<int>(GetChildren().size());
+    std::shared_lock guard(m_FolderInfo->m_Protect);
+    return static_cast<int>(m_FolderInfo->m_Children.size());
 }
 
 CTreeListItem* CItem::GetTreeListChild(const int i) const
 {
-    return GetChildren()[i];
+    std::shared_lock guard(m_FolderInfo->m_Protect);
+    return m_FolderInfo->m_Children[i];
+}
+
+void CItem::SetExpanded(const bool expanded)
+{
+    CTreeListItem::SetExpanded(expanded);
+    if (m_FolderInfo == nullptr) return;
+    m_FolderInfo->m_Shown = expanded;
+    m_FolderInfo->m_Posted = false;
+}
+
+// Returns whether children were posted already
+bool CItem::SetChildrenPosted(const bool posted) const
+{
+    return m_FolderInfo->m_Posted.exchange(posted);
 }
 
 short CItem::GetImageToCache() const
@@ -385,20 +699,36 @@ short CItem::GetImageToCache() const
         return GetIconImageList()->GetUnknownImage();
     }
 
-    const std::wstring longpath = GetPathLong();
-    if (CDirStatApp::Get()->GetReparseInfo()->IsVolumeMountPoint(longpath, m_Attributes))
+    // Links seen while scanning are known by their reparse tag
+    if (IsType(ITF_VOLMOUNT))
     {
         return GetIconImageList()->GetMountPointImage();
     }
-    if (CDirStatApp::Get()->GetReparseInfo()->IsSymbolicLink(longpath, m_Attributes) ||
-        CDirStatApp::Get()->GetReparseInfo()->IsJunction(longpath, m_Attributes))
+    if (IsType(ITF_LINK))
     {
-        constexpr DWORD mask = FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM;
-        const bool osFile = (GetAttributes() & mask) == mask;
-        return osFile ? GetIconImageList()->GetJunctionProtectedImage() : GetIconImageList()->GetJunctionImage();
+        return GetLinkImage(m_Attributes);
     }
 
-    return GetIconImageList()->GetFileImage(GetPath(), GetAttributes());
+    // Other reparse points and drives have to be looked at on disk
+    const DWORD attr = m_Attributes;
+    if (IsType(IT_DRIVE) || CReparsePoints::IsReparsePoint(attr))
+    {
+        const std::wstring path = GetPath();
+        return GetIconImageList()->GetResolvedImage(std::format(L"{}|{:x}", path, attr), [path, attr]
+        {
+            return ResolveImage(path, attr);
+        });
+    }
+
+    // The shell is only asked by name and attributes, so the image of anything
+    // else depends on nothing but its extension and whether it is a folder
+    const DWORD folder = attr & FILE_ATTRIBUTE_DIRECTORY;
+    const std::wstring ext = IsType(IT_FILE) ? GetExtension() : std::wstring();
+    return GetIconImageList()->GetResolvedImage(std::format(L"*{}|{:x}", ext, folder), [ext, folder]
+    {
+        return folder != 0 ? GetIconImageList()->GetFolderImage() :
+            GetIconImageList()->GetFileImage(L"file" + ext, folder);
+    });
 }
 
 void CItem::DrawAdditionalState(CDC* pdc, const CRect& rcLabel) const
@@ -486,8 +816,9 @@ void CItem::UpdateStatsFromDisk()
 
             if (IsType(IT_FILE))
             {
+                const bool countLink = !IsType(ITF_HARDLINK) || COptions::HardLinkPolicy == HLP_COUNT_ALL;
                 UpwardSubtractSizePhysical(m_SizePhysical);
-                UpwardAddSizePhysical(finder.GetFileSizePhysical());
+                UpwardAddSizePhysical(countLink ? finder.GetFileSizePhysical() : 0);
             }
         }
     }
@@ -507,6 +838,14 @@ const std::vector<CItem*>& CItem::GetChildren() const
     return m_FolderInfo->m_Children;
 }
 
+// Unlike GetChildren(), this may be called while the scanning threads add children
+std::vector<CItem*> CItem::CopyChildren() const
+{
+    if (m_FolderInfo == nullptr) return {};
+    std::shared_lock guard(m_FolderInfo->m_Protect);
+    return m_FolderInfo->m_Children;
+}
+
 CItem* CItem::GetParent() const
 {
     return reinterpret_cast<CItem*>(CTreeListItem::GetParent());
@@ -523,38 +862,49 @@ void CItem::AddChild(CItem* child, const bool addOnly)
 
     child->SetParent(this);
 
-    std::lock_guard guard(m_FolderInfo->m_Protect);
-    m_FolderInfo->m_Children.push_back(child);
+    {
+        std::lock_guard guard(m_FolderInfo->m_Protect);
+        m_FolderInfo->m_Children.push_back(child);
+    }
 
-    if (IsVisible() && IsExpanded())
+    // Scanning threads neither touch the visual state nor wait on the UI
+    // thread to show their children, they only post the shown parents
+    if (CDirStatApp::Get()->m_nThreadID != GetCurrentThreadId())
+    {
+        if (m_FolderInfo->m_Shown) CFileTreeControl::Get()->PostChildAdded(this);
+    }
+    else if (IsVisible() && IsExpanded())
     {
         (void)GetImage();
-        CMainFrame::Get()->InvokeInMessageThread([this, child]
-        {
-            CFileTreeControl::Get()->OnChildAdded(this, child);
-        });
+        CFileTreeControl::Get()->OnChildAdded(this, child);
     }
 }
 
 void CItem::RemoveChild(CItem* child)
 {
-    std::lock_guard guard(m_FolderInfo->m_Protect);
-    std::erase(m_FolderInfo->m_Children, child);
+    CFileDupeControl::Get()->TrackPromotedLinks(UntrackHardLinks({ child }));
 
-    if (IsVisible())
     {
-        CMainFrame::Get()->InvokeInMessageThread([this, child]
-        {
-            CFileTreeControl::Get()->OnChildRemoved(this, child);
-        });
+        std::lock_guard guard(m_FolderInfo->m_Protect);
+        std::erase(m_FolderInfo->m_Children, child);
     }
 
+    // Other threads leave removing the rows and deleting the child to the UI thread
+    if (CDirStatApp::Get()->m_nThreadID != GetCurrentThreadId())
+    {
+        if (m_FolderInfo->m_Shown) CFileTreeControl::Get()->PostChildRemoved(this, child);
+        else delete child;
+        return;
+    }
+
+    if (IsVisible()) CFileTreeControl::Get()->OnChildRemoved(this, child);
     delete child;
 }
 
 void CItem::RemoveAllChildren()
 {
     if (m_FolderInfo == nullptr) return;
+    CFileDupeControl::Get()->TrackPromotedLinks(UntrackHardLinks(m_FolderInfo->m_Children));
     CMainFrame::Get()->InvokeInMessageThread([this]
     {
         CFileTreeControl::Get()->OnRemovingAllChildren(this);
@@ -794,23 +1144,71 @@ std::wstring CItem::GetPathLong() const
 
 std::wstring CItem::GetOwner(const bool force) const
 {
-    if (!IsVisible() && !force)
+    // Forced lookups are used when saving results, so these wait for the owner
+    if (force)
+    {
+        if (IsVisible() && m_VisualInfo->owner.has_value()) return m_VisualInfo->owner.value();
+        return ResolveOwner(GetPathLong(), GetOwnerSid(m_OwnerSid));
+    }
+
+    if (!IsVisible())
     {
         return {};
     }
 
-    // If visible, use cached variable
-    std::wstring tmp;
-    std::wstring & ret = (force) ? tmp : m_VisualInfo->owner;
-    if (!ret.empty()) return ret;
+    return RequestOwner().value_or(Localization::Lookup(IDS_OWNER_RESOLVING));
+}
 
-    // Fetch owner information from disk
-    SmartPointer<PSECURITY_DESCRIPTOR> ps(LocalFree);
-    PSID sid = nullptr;
-    GetNamedSecurityInfo(GetPathLong().c_str(), SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION,
-        &sid, nullptr, nullptr, nullptr, &ps);
-    ret = GetNameFromSid(sid);
-    return ret;
+// Returns the owner once it has been resolved in the background; until then
+// the lookup is queued with the most recent requests (the visible rows) first
+std::optional<std::wstring> CItem::RequestOwner() const
+{
+    if (IsVisible() && m_VisualInfo->owner.has_value()) return m_VisualInfo->owner;
+
+    const std::wstring path = GetPathLong();
+    std::lock_guard lock(OwnerLock);
+    if (const auto resolved = OwnersResolved.find(path); resolved != OwnersResolved.end())
+    {
+        // Rows sorted before they come on screen leave the owner to be taken then
+        if (!IsVisible()) return resolved->second;
+        m_VisualInfo->owner = std::move(resolved->second);
+        OwnersResolved.erase(resolved);
+        OwnersPending.erase(path);
+        return m_VisualInfo->owner;
+    }
+
+    if (OwnersPending.insert(path).second)
+    {
+        while (OwnerThreads.size() < OWNER_THREADS) OwnerThreads.emplace_back(ResolveOwners);
+        OwnerRequests.push_front({ path, GetOwnerSid(m_OwnerSid), OwnersGeneration });
+        OwnerRequested.notify_one();
+    }
+
+    return std::nullopt;
+}
+
+// Stores the owner as if it had been resolved in the background,
+// for items whose path cannot be looked up such as synthetic ones
+void CItem::SetResolvedOwner(std::wstring owner) const
+{
+    std::lock_guard lock(OwnerLock);
+    OwnersResolved.insert_or_assign(GetPathLong(), std::move(owner));
+}
+
+bool CItem::HaveOwnersResolved()
+{
+    return OwnersChanged.exchange(false);
+}
+
+// Owners may have changed on disk when scanning again, so earlier results
+// are dropped, as are those of lookups still running
+void CItem::ResetOwners()
+{
+    std::lock_guard lock(OwnerLock);
+    OwnerRequests.clear();
+    OwnersPending.clear();
+    OwnersResolved.clear();
+    OwnersGeneration++;
 }
 
 bool CItem::HasUncPath() const
@@ -851,6 +1249,13 @@ std::wstring CItem::GetExtension() const
     return m_Extension;
 }
 
+LPCWSTR CItem::FindExtensionId(const std::wstring& ext)
+{
+    std::shared_lock lock(ExtensionLock);
+    const auto cached = Extensions.find(ext);
+    return cached != Extensions.end() ? cached->c_str() : nullptr;
+}
+
 ULONG CItem::GetFilesCount() const
 {
     if (m_FolderInfo == nullptr) return 0;
@@ -934,6 +1339,8 @@ void CItem::ScanItems(BlockingQueue<CItem*> * queue)
 {
     while (CItem * item = queue->Pop())
     {
+        PublishScanItem(item);
+
         // Mark the time we started evaluating this node
         if (item->m_FolderInfo) item->m_FolderInfo->m_Tstart = static_cast<ULONG>(GetTickCount64() / 1000ull);
 
@@ -968,8 +1375,8 @@ void CItem::ScanItems(BlockingQueue<CItem*> * queue)
                     queue->WaitIfSuspended();
                 }
 
-                // Update pacman position
-                item->UpwardDrivePacman();
+                // Count the entry for the progress sampled by the UI
+                PublishScanStep();
             }
         }
         else if (item->IsType(IT_FILE))
@@ -987,7 +1394,7 @@ void CItem::ScanItems(BlockingQueue<CItem*> * queue)
             }
         }
         item->UpwardSubtractReadJobs(1);
-        item->UpwardDrivePacman();
+        PublishScanItem(nullptr);
     }
 }
 
@@ -1279,6 +1686,18 @@ CItem* CItem::AddDirectory(const FileFindEnhanced& finder)
     const auto & child = new CItem(IT_DIRECTORY, finder.GetFileName());
     child->SetLastChange(finder.GetLastWriteTime());
     child->SetAttributes(finder.GetAttributes());
+
+    // Remember links by their reparse tag so that they need no lookups when shown
+    if (const DWORD tag = finder.GetReparseTag(); tag == IO_REPARSE_TAG_MOUNT_POINT)
+    {
+        const bool mount = CDirStatApp::Get()->GetReparseInfo()->IsVolumeMountPoint(finder.GetFilePathLong(), finder.GetAttributes());
+        child->SetType(mount ? ITF_VOLMOUNT : ITF_LINK);
+    }
+    else if (tag == IO_REPARSE_TAG_SYMLINK)
+    {
+        child->SetType(ITF_LINK);
+    }
+    if (COptions::ScanForOwners) child->m_OwnerSid = RegisterOwnerSid(finder.GetFilePathLong());
     AddChild(child);
     child->UpwardAddReadJobs(follow ? 1 : 0);
     return child;
@@ -1291,81 +1710,309 @@ CItem* CItem::AddFile(const FileFindEnhanced& finder)
     child->SetSizeLogical(finder.GetFileSizeLogical());
     child->SetLastChange(finder.GetLastWriteTime());
     child->SetAttributes(finder.GetAttributes());
+    if (COptions::ScanForOwners) child->m_OwnerSid = RegisterOwnerSid(finder.GetFilePathLong());
+    child->TrackHardLink(finder);
     AddChild(child);
     child->SetDone();
     return child;
 }
 
-void CItem::UpwardDrivePacman()
+void CItem::TrackHardLink(const FileFindEnhanced& finder)
 {
-    if (!COptions::PacmanAnimation)
+    // Tracking is only needed to attribute sizes once or to avoid hashing the same data
+    if (COptions::HardLinkPolicy == HLP_COUNT_ALL && !COptions::ScanForDuplicates) return;
+    if (finder.GetFileId() == 0) return;
+
+    const FILEIDENTITY identity = { finder.GetVolumeSerial(), finder.GetFileId() };
     {
-        return;
+        HARDLINKSHARD& shard = GetHardLinkShard(FILEIDENTITYHASH{}(identity));
+        std::lock_guard guard(shard.lock);
+        if (!shard.owners.emplace(identity, HARDLINKOWNER{ this, finder.GetFileSizePhysical() }).second)
+        {
+            // Another link to this data has already been seen
+            shard.links.emplace(identity, this);
+            SetType(ITF_HARDLINK);
+            if (COptions::HardLinkPolicy == HLP_COUNT_FIRST) SetSizePhysical(0);
+        }
     }
 
-    for (auto p = this; p != nullptr; p = p->GetParent())
+    HARDLINKSHARD& shard = GetHardLinkShard(std::hash<const CItem*>{}(this));
+    std::lock_guard guard(shard.lock);
+    shard.identities.emplace(this, identity);
+    ++HardLinksTracked;
+}
+
+// When the link owning the data is removed, the next link takes over. It is only
+// counted in its place and returned if promote is set; the destructor merely hands
+// over the ownership, as all links are destroyed anyway when the tree is torn down.
+CItem* CItem::UntrackHardLink(const bool promote) const
+{
+    if (HardLinksTracked == 0) return nullptr;
+
+    FILEIDENTITY identity = {};
+    {
+        HARDLINKSHARD& shard = GetHardLinkShard(std::hash<const CItem*>{}(this));
+        std::lock_guard guard(shard.lock);
+        const auto entry = shard.identities.find(this);
+        if (entry == shard.identities.end()) return nullptr;
+        identity = entry->second;
+        shard.identities.erase(entry);
+        --HardLinksTracked;
+    }
+
+    HARDLINKSHARD& shard = GetHardLinkShard(FILEIDENTITYHASH{}(identity));
+    std::unique_lock guard(shard.lock);
+    const auto owner = shard.owners.find(identity);
+    ASSERT(owner != shard.owners.end());
+    const auto links = shard.links.equal_range(identity);
+    if (owner->second.item != this)
     {
-        if (p->IsType(IT_FILE) || !p->IsVisible()) continue;
-        if (p->GetReadJobs() == 0) p->StopPacman();
-        else p->DrivePacman();
+        const auto link = std::find_if(links.first, links.second, [this](const auto& entry) { return entry.second == this; });
+        ASSERT(link != links.second);
+        shard.links.erase(link);
+        return nullptr;
     }
+
+    if (links.first == links.second)
+    {
+        shard.owners.erase(owner);
+        return nullptr;
+    }
+
+    CItem* next = links.first->second;
+    shard.links.erase(links.first);
+    owner->second.item = next;
+    const ULONGLONG sizePhysical = owner->second.sizePhysical;
+    guard.unlock();
+    if (!promote) return nullptr;
+
+    next->SetType(ITF_HARDLINK, false);
+    if (COptions::HardLinkPolicy == HLP_COUNT_FIRST) next->UpwardAddSizePhysical(sizePhysical);
+    return next;
 }
 
-std::wstring CItem::GetFileHash(ULONGLONG hashSizeLimit, BlockingQueue<CItem*>* queue)
+// Untracks the files below items before they are removed. Additional links go
+// first, so that a link taking over from a removed owner lies outside of them.
+std::vector<CItem*> CItem::UntrackHardLinks(const std::vector<CItem*>& items)
 {
-    // Initialize hash for this thread
-    constexpr auto maxBufferSize = 2ull * 1024ull * 1024ull;
-    thread_local std::vector<BYTE> FileBuffer(static_cast<std::size_t>(hashSizeLimit > 0 ? hashSizeLimit : maxBufferSize));
-    thread_local std::vector<BYTE> Hash;
-    thread_local SmartPointer<BCRYPT_HASH_HANDLE> HashHandle(BCryptDestroyHash);
-    thread_local DWORD HashLength = 0;
+    std::vector<CItem*> promoted;
+    if (HardLinksTracked == 0) return promoted;
 
-    if (HashLength == 0)
+    std::vector<const CItem*> owners;
+    std::vector<const CItem*> queue(items.begin(), items.end());
+    while (!queue.empty())
     {
-        BCRYPT_ALG_HANDLE AlgHandle = nullptr;
-        DWORD ResultLength = 0;
-        if (BCryptOpenAlgorithmProvider(&AlgHandle, BCRYPT_SHA256_ALGORITHM, MS_PRIMITIVE_PROVIDER, BCRYPT_HASH_REUSABLE_FLAG) != 0 ||
-            BCryptGetProperty(AlgHandle, BCRYPT_HASH_LENGTH, reinterpret_cast<PBYTE>(&HashLength), sizeof(HashLength), &ResultLength, 0) != 0 ||
-            BCryptCreateHash(AlgHandle, &HashHandle, nullptr, 0, nullptr, 0, BCRYPT_HASH_REUSABLE_FLAG) != 0)
+        const CItem* item = queue.back();
+        queue.pop_back();
+        if (item->IsType(IT_FILE))
         {
-            return {};
+            if (item->IsType(ITF_HARDLINK)) item->UntrackHardLink(false);
+            else owners.push_back(item);
+        }
+        else if (item->m_FolderInfo != nullptr)
+        {
+            for (const auto& child : item->m_FolderInfo->m_Children)
+            {
+                queue.push_back(child);
+            }
         }
     }
 
-    // Open file for reading
+    for (const CItem* owner : owners)
+    {
+        if (CItem* next = owner->UntrackHardLink(true); next != nullptr) promoted.push_back(next);
+    }
+    return promoted;
+}
+
+// Returns the link owning the data of this file, which may be the file
+// itself, or nullptr if no other link to the data has been seen
+CItem* CItem::GetHardLinkOwner() const
+{
+    if (HardLinksTracked == 0) return nullptr;
+
+    FILEIDENTITY identity = {};
+    {
+        HARDLINKSHARD& shard = GetHardLinkShard(std::hash<const CItem*>{}(this));
+        std::lock_guard guard(shard.lock);
+        const auto entry = shard.identities.find(this);
+        if (entry == shard.identities.end()) return nullptr;
+        identity = entry->second;
+    }
+
+    HARDLINKSHARD& shard = GetHardLinkShard(FILEIDENTITYHASH{}(identity));
+    std::lock_guard guard(shard.lock);
+    const auto owner = shard.owners.find(identity);
+    if (owner == shard.owners.end() || !shard.links.contains(identity)) return nullptr;
+    return owner->second.item;
+}
+
+void CItem::PublishScanItem(CItem* item)
+{
+    GetScanProgress().item.store(item, std::memory_order_relaxed);
+}
+
+void CItem::PublishScanStep()
+{
+    // Only the owning thread writes its counter, so no atomic increment is needed
+    std::atomic<ULONGLONG>& steps = GetScanProgress().steps;
+    steps.store(steps.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// Called by the UI timer; drives the pacman of the visible folders in which a
+// scanning thread has made progress since the last sample. Folders which are
+// done do not show their pacman anymore, so they need not be stopped.
+void CItem::SampleScanProgress()
+{
+    if (!COptions::PacmanAnimation)
+    {
+        return;
+    }
+
+    std::lock_guard lock(ScanProgressLock);
+    for (auto& progress : ScanProgress)
+    {
+        const ULONGLONG steps = progress.steps.load(std::memory_order_relaxed);
+        if (steps == progress.sampled) continue;
+        progress.sampled = steps;
+
+        for (auto p = progress.item.load(std::memory_order_relaxed); p != nullptr; p = p->GetParent())
+        {
+            if (!p->IsType(IT_FILE) && p->IsVisible()) p->DrivePacman();
+        }
+    }
+}
+
+std::wstring CItem::GetFileHash(const ULONGLONG hashSizeLimit, BlockingQueue<CItem*>* queue)
+{
+    // Buffers are always the same size so a partial hash does not limit later full hashes
+    constexpr auto readBufferSize = 1024ull * 1024ull;
+    thread_local std::array<HASHREAD, 3> Reads;
+    if (!InitializeHashing()) return {};
+
+    // Open file for overlapped reading
     SmartPointer<HANDLE> hFile(CloseHandle, CreateFile(GetPathLong().c_str(), GENERIC_READ, FILE_SHARE_READ,
-        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_OVERLAPPED, nullptr));
     if (hFile == INVALID_HANDLE_VALUE)
     {
         return {};
     }
-    
-    // Hash data one read at a time
-    DWORD iReadResult = 0;
-    DWORD iHashResult = 0;
-    DWORD iReadBytes = 0;
-    Hash.resize(HashLength);
-    while ((iReadResult = ReadFile(hFile, FileBuffer.data(), static_cast<DWORD>(FileBuffer.size()),
-        &iReadBytes, nullptr)) != 0 && iReadBytes > 0)
-    {
-        UpwardDrivePacman();
-        iHashResult = BCryptHashData(HashHandle, FileBuffer.data(), iReadBytes, 0);
-        if (iHashResult != 0 || hashSizeLimit > 0) break;
+
+    // Queues a read of the next region of the file into the passed buffer
+    const ULONGLONG readLimit = hashSizeLimit > 0 ? hashSizeLimit : ULLONG_MAX;
+    ULONGLONG nextOffset = 0;
+    const auto issueRead = [&](HASHREAD& read)
+    {
+        read.pending = false;
+        if (nextOffset >= readLimit) return true;
+
+        read.buffer.resize(readBufferSize);
+        read.requested = static_cast<DWORD>(std::min(readBufferSize, readLimit - nextOffset));
+        read.overlapped = {};
+        read.overlapped.Offset = static_cast<DWORD>(nextOffset);
+        read.overlapped.OffsetHigh = static_cast<DWORD>(nextOffset >> 32);
+        read.overlapped.hEvent = read.event;
+        nextOffset += read.requested;
+
+        if (ReadFile(hFile, read.buffer.data(), read.requested, nullptr, &read.overlapped) == 0)
+        {
+            if (const DWORD error = GetLastError(); error != ERROR_IO_PENDING)
+            {
+                nextOffset = readLimit;
+                return error == ERROR_HANDLE_EOF;
+            }
+        }
+
+        read.pending = true;
+        return true;
+    };
+
+    // Hash each buffer in order while the other buffers are being filled
+    bool success = std::ranges::all_of(Reads, issueRead);
+    for (std::size_t current = 0; success && Reads[current].pending; current = (current + 1) % Reads.size())
+    {
+        HASHREAD& read = Reads[current];
+        read.pending = false;
+
+        DWORD iReadBytes = 0;
+        if (GetOverlappedResult(hFile, &read.overlapped, &iReadBytes, TRUE) == 0)
+        {
+            success = GetLastError() == ERROR_HANDLE_EOF;
+            break;
+        }
+
+        PublishScanStep();
+        if (iReadBytes > 0 && !UpdateHashing(read.buffer.data(), iReadBytes))
+        {
+            success = false;
+            break;
+        }
+
+        // A short read indicates the end of the file
+        if (iReadBytes < read.requested) break;
+
         queue->WaitIfSuspended();
+        success = issueRead(read);
+    }
+
+    // Reads still in flight must complete before their buffers can be reused
+    for (auto& read : Reads)
+    {
+        if (!read.pending) continue;
+        DWORD iReadBytes = 0;
+        CancelIoEx(hFile, &read.overlapped);
+        GetOverlappedResult(hFile, &read.overlapped, &iReadBytes, TRUE);
+        read.pending = false;
     }
 
     // Complete hash data
-    if (iHashResult != 0 || iReadResult == 0 ||
-        BCryptFinishHash(HashHandle, Hash.data(), HashLength, 0) != 0)
+    if (!success)
+    {
+        FinishHashing();
+        return {};
+    }
+
+    return FinishHashing();
+}
+
+std::wstring CItem::GetFileHashSampled(const ULONGLONG blockSize, const int blockCount, BlockingQueue<CItem*>* queue)
+{
+    thread_local std::vector<BYTE> SampleBuffer;
+    SampleBuffer.resize(static_cast<std::size_t>(blockSize));
+    if (blockCount < 2 || !InitializeHashing()) return {};
+
+    // Open file for reading at arbitrary offsets
+    SmartPointer<HANDLE> hFile(CloseHandle, CreateFile(GetPathLong().c_str(), GENERIC_READ, FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_RANDOM_ACCESS, nullptr));
+    if (hFile == INVALID_HANDLE_VALUE)
     {
         return {};
     }
 
-    // Convert to hex string
-    std::wstring sHash;
-    sHash.resize(2ull * HashLength);
-    DWORD iHashStringLength = static_cast<DWORD>(sHash.size() + 1ull);
-    CryptBinaryToStringW(Hash.data(), HashLength, CRYPT_STRING_HEXRAW | CRYPT_STRING_NOCRLF,
-        sHash.data(), &iHashStringLength);
-    return sHash;
+    // Spread the samples evenly across the file which always includes the first and last
+    // blocks; offsets are derived from the size so same-sized files sample the same spots
+    const ULONGLONG lastOffset = GetSizeLogical() > blockSize ? GetSizeLogical() - blockSize : 0;
+    for (int block = 0; block < blockCount; block++)
+    {
+        constexpr ULONGLONG alignment = 4096;
+        const ULONGLONG offset = block == blockCount - 1 ? lastOffset :
+            (lastOffset * block / (blockCount - 1)) & ~(alignment - 1);
+
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD iReadBytes = 0;
+        if (ReadFile(hFile, SampleBuffer.data(), static_cast<DWORD>(SampleBuffer.size()),
+            &iReadBytes, &overlapped) == 0 ||
+            !UpdateHashing(SampleBuffer.data(), iReadBytes))
+        {
+            FinishHashing();
+            return {};
+        }
+
+        PublishScanStep();
+        queue->WaitIfSuspended();
+    }
+
+    return FinishHashing();
 }
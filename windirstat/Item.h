@@ -28,6 +28,7 @@
 #include "BlockingQueue.h"
 
 #include <algorithm>
+#include <optional>
 #include <shared_mutex>
 
 // Columns
@@ -61,6 +62,10 @@ enum ITEMTYPE : unsigned short
     ITF_ROOTITEM  = 1 << 9,  // Indicates root item
     ITF_PARTHASH  = 1 << 10, // Indicates a partial hash
     ITF_FULLHASH  = 1 << 11, // Indicates a full hash
+    ITF_HARDLINK  = 1 << 12, // Indicates an additional link to an already seen file
+    ITF_SAMPHASH  = 1 << 13, // Indicates a sampled hash
+    ITF_LINK      = 1 << 14, // Indicates a junction or symbolic link seen while scanning
+    ITF_VOLMOUNT  = 1 << 15, // Indicates a volume mount point seen while scanning
     ITF_FLAGS     = 0xFF00,  // All potential flag items
 };
 
@@ -121,9 +126,12 @@ public:
     std::wstring GetText(int subitem) const override;
     COLORREF GetItemTextColor() const override;
     int CompareSibling(const CTreeListItem* tlib, int subitem) const override;
+    SORTKEY GetSortKey(int subitem) const override;
     int GetTreeListChildCount() const override;
     CTreeListItem* GetTreeListChild(int i) const override;
     short GetImageToCache() const override;
+    void SetExpanded(bool expanded = true) override;
+    bool SetChildrenPosted(bool posted) const override;
     void DrawAdditionalState(CDC* pdc, const CRect& rcLabel) const override;
 
     // CTreeMap::Item interface
@@ -140,6 +148,11 @@ public:
         return GetGraphColor();
     }
 
+    const void* TmiGetGroup() const override
+    {
+        return IsType(IT_FILE) ? m_Extension : nullptr;
+    }
+
     int TmiGetChildCount() const override
     {
         if (!m_FolderInfo) return 0;
@@ -156,14 +169,65 @@ public:
         return GetSizePhysical();
     }
 
+    // Access policy for CTreeMap::SetItemAccess(), which reads the
+    // children and sizes without virtual calls
+    struct TreeMapAccess
+    {
+        static bool IsLeaf(const CTreeMap::Item* item)
+        {
+            return Get(item)->IsType(IT_FILE | IT_FREESPACE | IT_UNKNOWN);
+        }
+
+        static int GetChildCount(const CTreeMap::Item* item)
+        {
+            const CHILDINFO* info = Get(item)->m_FolderInfo;
+            return info != nullptr ? static_cast<int>(info->m_Children.size()) : 0;
+        }
+
+        static CTreeMap::Item* GetChild(const CTreeMap::Item* item, const int i)
+        {
+            return Get(item)->m_FolderInfo->m_Children[i];
+        }
+
+        static ULONGLONG GetSize(const CTreeMap::Item* item)
+        {
+            return Get(item)->m_SizePhysical.load(std::memory_order_relaxed);
+        }
+
+        static void SetRectangle(CTreeMap::Item* item, const CRect& rc)
+        {
+            static_cast<CItem*>(item)->m_Rect = rc;
+        }
+
+        // The children are sorted by size whenever a folder is done,
+        // so the strip style keeps them in the order of their names
+        static bool IsStripBefore(const CTreeMap::Item* a, const CTreeMap::Item* b)
+        {
+            return _wcsicmp(Get(a)->m_Name.c_str(), Get(b)->m_Name.c_str()) < 0;
+        }
+
+    private:
+        static const CItem* Get(const CTreeMap::Item* item)
+        {
+            return static_cast<const CItem*>(item);
+        }
+    };
+
     // CItem
     static int GetSubtreePercentageWidth();
     static CItem* FindCommonAncestor(const CItem* item1, const CItem* item2);
+    static LPCWSTR FindExtensionId(const std::wstring& ext);
+    static bool HaveOwnersResolved();
+    static void ResetOwners();
+    static void PublishScanItem(CItem* item);
+    static void PublishScanStep();
+    static void SampleScanProgress();
 
     ULONGLONG GetProgressRange() const;
     ULONGLONG GetProgressPos() const;
     void UpdateStatsFromDisk();
     const std::vector<CItem*>& GetChildren() const;
+    std::vector<CItem*> CopyChildren() const;
     CItem* GetParent() const;
     void AddChild(CItem* child, bool addOnly = false);
     void RemoveChild(CItem* child);
@@ -195,6 +259,7 @@ public:
     std::wstring GetPath() const;
     std::wstring GetPathLong() const;
     std::wstring GetOwner(bool force = false) const;
+    void SetResolvedOwner(std::wstring owner) const;
     bool HasUncPath() const;
     std::wstring GetFolderPath() const;
     std::wstring GetName() const;
@@ -220,6 +285,8 @@ public:
     void RemoveUnknownItem();
     void CollectExtensionData(CExtensionData* ed) const;
     std::wstring GetFileHash(ULONGLONG hashSizeLimit, BlockingQueue<CItem*>* queue);
+    std::wstring GetFileHashSampled(ULONGLONG blockSize, int blockCount, BlockingQueue<CItem*>* queue);
+    CItem* GetHardLinkOwner() const;
 
     bool IsDone() const
     {
@@ -254,9 +321,12 @@ private:
     bool MustShowReadJobs() const;
     COLORREF GetPercentageColor() const;
     std::wstring UpwardGetPathWithoutBackslash() const;
+    std::optional<std::wstring> RequestOwner() const;
     CItem* AddDirectory(const FileFindEnhanced& finder);
     CItem* AddFile(const FileFindEnhanced& finder);
-    void UpwardDrivePacman();
+    void TrackHardLink(const FileFindEnhanced& finder);
+    CItem* UntrackHardLink(bool promote) const;
+    static std::vector<CItem*> UntrackHardLinks(const std::vector<CItem*>& items);
 
     // Special structure for container items that is separately allocated to
     // reduce memory usage.  This operates under the assumption that most
@@ -270,6 +340,8 @@ private:
         std::atomic<ULONG> m_Files = 0;   // # Files in subtree
         std::atomic<ULONG> m_Subdirs = 0; // # Folder in subtree
         std::atomic<ULONG> m_Jobs = 0;    // # "read jobs" in subtree.
+        std::atomic<bool> m_Shown = false;  // Whether the children are rows of the file tree
+        std::atomic<bool> m_Posted = false; // Whether added children await the UI thread
     };
 
     RECT m_Rect;                                // To support TreeMapView
@@ -281,4 +353,5 @@ private:
     std::atomic<ULONGLONG> m_SizeLogical = 0;   // Total local size of self or subtree
     DWORD m_Attributes = 0;                     // Packed file attributes of the item
     ITEMTYPE m_Type;                            // Indicates our type.
+    unsigned short m_OwnerSid = 0;              // Index of the owner collected while scanning, 0 if none
 };
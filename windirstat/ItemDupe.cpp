@@ -30,11 +30,26 @@
 #include <functional>
 #include <queue>
 
-CItemDupe::CItemDupe(const std::wstring& hash, const ULONGLONG sizePhysical, const ULONGLONG sizeLogical) :
-    m_Hash(hash), m_SizePhysical(sizePhysical), m_SizeLogical(sizeLogical) {}
+CItemDupe::CItemDupe(const std::wstring& hash, const ULONGLONG sizePhysical, const ULONGLONG sizeLogical, const bool folders) :
+    m_Hash(hash), m_SizePhysical(sizePhysical), m_SizeLogical(sizeLogical), m_Folders(folders) {}
 
 CItemDupe::CItemDupe(CItem* item) : m_Item(item) {}
 
+CItemDupe::~CItemDupe()
+{
+    for (const auto& child : m_Children)
+    {
+        delete child;
+    }
+}
+
+ULONGLONG CItemDupe::GetCopies() const
+{
+    // For folders only the additional copies could be reclaimed
+    const ULONGLONG copies = m_Children.size();
+    return m_Folders && copies > 0 ? copies - 1 : copies;
+}
+
 bool CItemDupe::DrawSubitem(const int subitem, CDC* pdc, const CRect rc, const UINT state, int* width, int* focusLeft) const
 {
     // Handle individual file items
@@ -53,8 +68,8 @@ std::wstring CItemDupe::GetText(const int subitem) const
     {
         // Handle top-level hash collection nodes
         if (subitem == COL_ITEMDUP_NAME) return m_Hash;
-        if (subitem == COL_ITEMDUP_SIZE_PHYSICAL) return FormatBytes(m_SizePhysical * GetChildren().size());
-        if (subitem == COL_ITEMDUP_SIZE_LOGICAL) return FormatBytes(m_SizeLogical * GetChildren().size());
+        if (subitem == COL_ITEMDUP_SIZE_PHYSICAL) return FormatBytes(m_SizePhysical * GetCopies());
+        if (subitem == COL_ITEMDUP_SIZE_LOGICAL) return FormatBytes(m_SizeLogical * GetCopies());
         if (subitem == COL_ITEMDUP_ITEMS) return FormatCount(GetChildren().size());
         return {};
     }
@@ -75,8 +90,8 @@ int CItemDupe::CompareSibling(const CTreeListItem* tlib, const int subitem) cons
     {
         // Handle top-level hash collection nodes
         if (subitem == COL_ITEMDUP_NAME) return signum(_wcsicmp(m_Hash.c_str(),other->m_Hash.c_str()));
-        if (subitem == COL_ITEMDUP_SIZE_PHYSICAL) return usignum(m_SizePhysical * m_Children.size(), other->m_SizePhysical * other->m_Children.size());
-        if (subitem == COL_ITEMDUP_SIZE_LOGICAL) return usignum(m_SizeLogical * m_Children.size(), other->m_SizeLogical * other->m_Children.size());
+        if (subitem == COL_ITEMDUP_SIZE_PHYSICAL) return usignum(m_SizePhysical * GetCopies(), other->m_SizePhysical * other->GetCopies());
+        if (subitem == COL_ITEMDUP_SIZE_LOGICAL) return usignum(m_SizeLogical * GetCopies(), other->m_SizeLogical * other->GetCopies());
         if (subitem == COL_ITEMDUP_ITEMS) return usignum(m_Children.size(), other->m_Children.size());
         return 0;
     }
@@ -85,6 +100,25 @@ int CItemDupe::CompareSibling(const CTreeListItem* tlib, const int subitem) cons
     return m_Item->CompareSibling(other->m_Item, columnMap.at(subitem));
 }
 
+CTreeListItem::SORTKEY CItemDupe::GetSortKey(const int subitem) const
+{
+    // Root node
+    if (GetParent() == nullptr) return {};
+
+    // Parent hash nodes
+    if (m_Item == nullptr)
+    {
+        if (subitem == COL_ITEMDUP_NAME) return SORTKEY::FromText(m_Hash);
+        if (subitem == COL_ITEMDUP_SIZE_PHYSICAL) return { m_SizePhysical * GetCopies() };
+        if (subitem == COL_ITEMDUP_SIZE_LOGICAL) return { m_SizeLogical * GetCopies() };
+        if (subitem == COL_ITEMDUP_ITEMS) return { m_Children.size() };
+        return {};
+    }
+
+    // Individual file names
+    return m_Item->GetSortKey(columnMap.at(subitem));
+}
+
 int CItemDupe::GetTreeListChildCount()const
 {
     return static_cast<int>(m_Children.size());
@@ -117,7 +151,7 @@ CItemDupe* CItemDupe::GetParent() const
     return reinterpret_cast<CItemDupe*>(CTreeListItem::GetParent());
 }
 
-void CItemDupe::AddChild(CItemDupe* child)
+void CItemDupe::AddChild(CItemDupe* child, const bool sort)
 {
     child->SetParent(this);
 
@@ -126,9 +160,9 @@ void CItemDupe::AddChild(CItemDupe* child)
 
     if (IsVisible() && IsExpanded())
     {
-        CMainFrame::Get()->InvokeInMessageThread([this, child]
+        CMainFrame::Get()->InvokeInMessageThread([this, child, sort]
         {
-            CFileDupeControl::Get()->OnChildAdded(this, child);
+            CFileDupeControl::Get()->OnChildAdded(this, child, sort);
         });
     }
 }
@@ -24,7 +24,7 @@
 #include "stdafx.h"
 #include "Item.h"
 
-#include <unordered_map>
+#include <array>
 
 // Columns
 using ITEMDUPCOLUMNS = enum
@@ -42,6 +42,7 @@ class CItemDupe final : public CTreeListItem
     ULONGLONG m_SizePhysical = 0;
     ULONGLONG m_SizeLogical = 0;
     CItem* m_Item = nullptr;
+    bool m_Folders = false; // Groups identical folders and shows the reclaimable size
     std::shared_mutex m_Protect;
     std::vector<CItemDupe*> m_Children;
 
@@ -51,32 +52,34 @@ public:
     CItemDupe& operator=(const CItemDupe&) = delete;
     CItemDupe& operator=(CItemDupe&&) = delete;
     CItemDupe() = default;
-    CItemDupe(const std::wstring & hash, ULONGLONG sizePhysical, ULONGLONG sizeLogical);
+    CItemDupe(const std::wstring & hash, ULONGLONG sizePhysical, ULONGLONG sizeLogical, bool folders = false);
     CItemDupe(CItem* item);
-    ~CItemDupe() override = default;
+    ~CItemDupe() override;
 
-    // Translation map for leveraging Item routines
-    const std::unordered_map<int, int> columnMap =
+    // Translation table for leveraging Item routines (indexed by ITEMDUPCOLUMNS)
+    static constexpr std::array<int, 5> columnMap =
     {
-        { COL_ITEMDUP_NAME, COL_NAME },
-        { COL_ITEMDUP_ITEMS, COL_ITEMS },
-        { COL_ITEMDUP_SIZE_LOGICAL, COL_SIZE_LOGICAL },
-        { COL_ITEMDUP_SIZE_PHYSICAL, COL_SIZE_PHYSICAL },
-        { COL_ITEMDUP_LASTCHANGE, COL_LASTCHANGE }
+        COL_NAME,          // COL_ITEMDUP_NAME
+        COL_ITEMS,         // COL_ITEMDUP_ITEMS
+        COL_SIZE_PHYSICAL, // COL_ITEMDUP_SIZE_PHYSICAL
+        COL_SIZE_LOGICAL,  // COL_ITEMDUP_SIZE_LOGICAL
+        COL_LASTCHANGE     // COL_ITEMDUP_LASTCHANGE
     };
 
     // CTreeListItem Interface
     bool DrawSubitem(int subitem, CDC* pdc, CRect rc, UINT state, int* width, int* focusLeft) const override;
     std::wstring GetText(int subitem) const override;
     int CompareSibling(const CTreeListItem* tlib, int subitem) const override;
+    SORTKEY GetSortKey(int subitem) const override;
     int GetTreeListChildCount() const override;
     CTreeListItem* GetTreeListChild(int i) const override;
     short GetImageToCache() const override;
 
     CItem* GetItem() const { return m_Item; }
+    ULONGLONG GetCopies() const;
     const std::vector<CItemDupe*>& GetChildren() const;
     CItemDupe* GetParent() const;
-    void AddChild(CItemDupe* child);
+    void AddChild(CItemDupe* child, bool sort = true);
     void RemoveChild(CItemDupe* child);
     void RemoveAllChildren();
 };
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+// A queue which any number of threads push to without ever locking or waiting;
+// a single consumer takes everything pushed so far at once, in push order
+template <typename T>
+class LockFreeQueue
+{
+    struct Node
+    {
+        T value;
+        Node* next;
+    };
+
+    std::atomic<Node*> m_Head = nullptr;
+
+public:
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue(LockFreeQueue&&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(LockFreeQueue&&) = delete;
+    LockFreeQueue() = default;
+
+    ~LockFreeQueue()
+    {
+        (void) PopAll();
+    }
+
+    void Push(T value)
+    {
+        const auto node = new Node{ std::move(value), m_Head.load(std::memory_order_relaxed) };
+        while (!m_Head.compare_exchange_weak(node->next, node,
+            std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+
+    std::vector<T> PopAll()
+    {
+        // Nodes are pushed onto the front, so the values are taken in reverse
+        std::vector<T> values;
+        for (Node* node = m_Head.exchange(nullptr, std::memory_order_acquire); node != nullptr;)
+        {
+            values.push_back(std::move(node->value));
+            delete std::exchange(node, node->next);
+        }
+        std::ranges::reverse(values);
+        return values;
+    }
+};
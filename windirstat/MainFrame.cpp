@@ -25,6 +25,7 @@
 #include "FileTabbedView.h"
 #include "FileTreeView.h"
 #include "ExtensionView.h"
+#include "FileDupeControl.h"
 #include "DirStatDoc.h"
 #include "GlobalHelpers.h"
 #include "Item.h"
@@ -824,15 +825,45 @@ void CMainFrame::OnTimer(const UINT_PTR nIDEvent)
         m_WndToolBar.OnUpdateCmdUI(this, FALSE);
     }
 
+    // Show the children added by the scanning threads since the last update
+    const bool sorted = CFileTreeControl::Get()->ProcessPostedChildren();
+
     // UI updates that do need to processed frequently
     if (doFastUpdate)
     {
         // Update the visual progress on the bottom of the screen
         UpdateProgress();
 
+        // Animate the folders in which the scanning threads made progress
+        CItem::SampleScanProgress();
+
         // By sorting items, items will be redrawn which will
         // also force pacman to update with recent position
-        CFileTreeControl::Get()->SortItems();
+        if (!sorted) CFileTreeControl::Get()->SortItems();
+    }
+
+    // Insert duplicates found by the scanning threads since the last update
+    if (CFileDupeControl::Get() != nullptr) CFileDupeControl::Get()->ProcessPendingDuplicates();
+
+    // Show images resolved in the background since the last update
+    if (GetIconImageList()->HaveImagesResolved())
+    {
+        CFileTreeControl::Get()->InvalidateRect(nullptr);
+        if (CFileDupeControl::Get() != nullptr) CFileDupeControl::Get()->InvalidateRect(nullptr);
+    }
+
+    // Show owners resolved in the background since the last update
+    if (CItem::HaveOwnersResolved())
+    {
+        if (const auto& sorting = CFileTreeControl::Get()->GetSorting();
+            sorting.subitem1 == COL_OWNER || sorting.subitem2 == COL_OWNER)
+        {
+            CFileTreeControl::Get()->SortItems();
+        }
+        else
+        {
+            CFileTreeControl::Get()->InvalidateRect(nullptr);
+        }
     }
 
     CFrameWndEx::OnTimer(nIDEvent);
@@ -45,6 +45,7 @@ Setting<bool> COptions::ListGrid(OptionsGeneral, L"ListGrid", false);
 Setting<bool> COptions::ListStripes(OptionsGeneral, L"ListStripes", false);
 Setting<bool> COptions::PacmanAnimation(OptionsGeneral, L"PacmanAnimation", true);
 Setting<bool> COptions::ScanForDuplicates(OptionsDupeTree, L"ScanForDuplicates", false);
+Setting<bool> COptions::ScanForOwners(OptionsGeneral, L"ScanForOwners", false);
 Setting<bool> COptions::ShowColumnAttributes(OptionsFileTree, L"ShowColumnAttributes", false);
 Setting<bool> COptions::ShowColumnFiles(OptionsFileTree, L"ShowColumnFiles", true);
 Setting<bool> COptions::ShowColumnFolders(OptionsFileTree, L"ShowColumnFolders", false);
@@ -80,6 +81,9 @@ Setting<COLORREF> COptions::TreeMapHighlightColor(OptionsTreeMap, L"TreeMapHighl
 Setting<double> COptions::MainSplitterPos(OptionsGeneral, L"MainSplitterPos", -1.0, 0.0, 1.0);
 Setting<double> COptions::SubSplitterPos(OptionsGeneral, L"SubSplitterPos", -1.0, 0.0, 1.0);
 Setting<int> COptions::ConfigPage(OptionsGeneral, L"ConfigPage", true);
+Setting<int> COptions::DupeSampleBlocks(OptionsDupeTree, L"DupeSampleBlocks", 5, 0, 64);
+Setting<int> COptions::DupeSampleBlockSize(OptionsDupeTree, L"DupeSampleBlockSize", 64, 4, 4096);
+Setting<int> COptions::HardLinkPolicy(OptionsGeneral, L"HardLinkPolicy", HLP_COUNT_FIRST, HLP_COUNT_ALL, HLP_COUNT_FIRST);
 Setting<int> COptions::LanguageId(OptionsGeneral, L"LanguageId", 0);
 Setting<int> COptions::ScanningThreads(OptionsGeneral, L"ScanningThreads", 6, 1, 16);
 Setting<int> COptions::SelectDrivesRadio(OptionsDriveSelect, L"SelectDrivesRadio", 0, 0, 2);
@@ -89,8 +93,11 @@ Setting<int> COptions::TreeMapBrightness(OptionsTreeMap, L"TreeMapBrightness", C
 Setting<int> COptions::TreeMapHeightFactor(OptionsTreeMap, L"TreeMapHeightFactor", CTreeMap::GetDefaults().GetHeightPercent(), 0, 100);
 Setting<int> COptions::TreeMapLightSourceX(OptionsTreeMap, L"TreeMapLightSourceX", CTreeMap::GetDefaults().GetLightSourceXPercent(), -200, 200);
 Setting<int> COptions::TreeMapLightSourceY(OptionsTreeMap, L"TreeMapLightSourceY", CTreeMap::GetDefaults().GetLightSourceYPercent(), -200, 200);
+Setting<int> COptions::TreeMapMinimumArea(OptionsTreeMap, L"TreeMapMinimumArea", CTreeMap::GetDefaults().minimumArea, 0, 4096);
+Setting<int> COptions::TreeMapProgressiveBudget(OptionsTreeMap, L"TreeMapProgressiveBudget", 5, 0, 100);
+Setting<int> COptions::TreeMapProgressiveDepth(OptionsTreeMap, L"TreeMapProgressiveDepth", 4, 1, 32);
 Setting<int> COptions::TreeMapScaleFactor(OptionsTreeMap, L"TreeMapScaleFactor", CTreeMap::GetDefaults().GetScaleFactorPercent(), 0, 100);
-Setting<int> COptions::TreeMapStyle(OptionsTreeMap, L"TreeMapStyle", CTreeMap::GetDefaults().style, 0, 1);
+Setting<int> COptions::TreeMapStyle(OptionsTreeMap, L"TreeMapStyle", CTreeMap::GetDefaults().style, 0, 2);
 Setting<RECT> COptions::AboutWindowRect(OptionsGeneral, L"AboutWindowRect");
 Setting<RECT> COptions::DriveSelectWindowRect(OptionsDriveSelect, L"DriveSelectWindowRect");
 Setting<std::vector<int>> COptions::DriveListColumnOrder(OptionsDriveSelect, L"DriveListColumnOrder");
@@ -161,6 +168,7 @@ void COptions::SetTreeMapOptions(const CTreeMap::Options& options)
     TreeMapAmbientLightPercent = TreeMapOptions.GetAmbientLightPercent();
     TreeMapLightSourceX = TreeMapOptions.GetLightSourceXPercent();
     TreeMapLightSourceY = TreeMapOptions.GetLightSourceYPercent();
+    TreeMapMinimumArea = TreeMapOptions.minimumArea;
 
     GetDocument()->UpdateAllViews(nullptr, HINT_TREEMAPSTYLECHANGED);
 }
@@ -202,6 +210,7 @@ void COptions::PostProcessPersistedSettings()
     TreeMapOptions.SetAmbientLightPercent(TreeMapAmbientLightPercent);
     TreeMapOptions.SetLightSourceXPercent(TreeMapLightSourceX);
     TreeMapOptions.SetLightSourceYPercent(TreeMapLightSourceY);
+    TreeMapOptions.minimumArea = TreeMapMinimumArea;
 
     // Adjust Title to language default Title
     for (int i = 0; i < USERDEFINEDCLEANUPCOUNT; i++)
@@ -36,6 +36,12 @@ enum REFRESHPOLICY
     RP_REFRESH_THIS_ENTRYS_PARENT
 };
 
+enum HARDLINKPOLICY
+{
+    HLP_COUNT_ALL,  // Every link contributes the physical size of the file
+    HLP_COUNT_FIRST // Only the first link found contributes the physical size
+};
+
 struct USERDEFINEDCLEANUP
 {
     USERDEFINEDCLEANUP() : USERDEFINEDCLEANUP(L"") {}
@@ -115,6 +121,7 @@ public:
     static Setting<bool> ListStripes;
     static Setting<bool> PacmanAnimation;
     static Setting<bool> ScanForDuplicates;
+    static Setting<bool> ScanForOwners;
     static Setting<bool> ShowColumnAttributes;
     static Setting<bool> ShowColumnFiles;
     static Setting<bool> ShowColumnFolders;
@@ -150,7 +157,10 @@ public:
     static Setting<double> MainSplitterPos;
     static Setting<double> SubSplitterPos;
     static Setting<int> ConfigPage;
+    static Setting<int> DupeSampleBlocks;
+    static Setting<int> DupeSampleBlockSize;
     static Setting<int> FollowReparsePointMask;
+    static Setting<int> HardLinkPolicy;
     static Setting<int> LanguageId;
     static Setting<int> ScanningThreads;
     static Setting<int> SelectDrivesRadio;
@@ -160,6 +170,9 @@ public:
     static Setting<int> TreeMapHeightFactor;
     static Setting<int> TreeMapLightSourceX;
     static Setting<int> TreeMapLightSourceY;
+    static Setting<int> TreeMapMinimumArea;
+    static Setting<int> TreeMapProgressiveBudget;
+    static Setting<int> TreeMapProgressiveDepth;
     static Setting<int> TreeMapScaleFactor;
     static Setting<int> TreeMapStyle;
     static Setting<RECT> AboutWindowRect;
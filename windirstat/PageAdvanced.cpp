@@ -44,6 +44,8 @@ void CPageAdvanced::DoDataExchange(CDataExchange* pDX)
     DDX_Check(pDX, IDC_EXCLUDE_JUNCTIONS, m_ExcludeJunctions);
     DDX_Check(pDX, IDC_EXCLUDE_SYMLINKS, m_ExcludeSymbolicLinks);
     DDX_Check(pDX, IDC_PAGE_ADVANCED_SKIP_CLOUD_LINKS, m_SkipDupeDetectionCloudLinks);
+    DDX_Check(pDX, IDC_SCAN_OWNERS, m_ScanForOwners);
+    DDX_Check(pDX, IDC_COUNT_HARDLINKS_ONCE, m_CountHardLinksOnce);
     DDX_Check(pDX, IDC_SKIPHIDDEN, m_SkipHidden);
     DDX_Check(pDX, IDC_SKIPPROTECTED, m_SkipProtected);
     DDX_Check(pDX, IDC_BACKUP_RESTORE, m_UseBackupRestore);
@@ -59,6 +61,8 @@ BEGIN_MESSAGE_MAP(CPageAdvanced, CPropertyPage)
     ON_BN_CLICKED(IDC_EXCLUDE_JUNCTIONS, OnSettingChanged)
     ON_BN_CLICKED(IDC_EXCLUDE_SYMLINKS, OnSettingChanged)
     ON_BN_CLICKED(IDC_PAGE_ADVANCED_SKIP_CLOUD_LINKS, OnSettingChanged)
+    ON_BN_CLICKED(IDC_SCAN_OWNERS, OnSettingChanged)
+    ON_BN_CLICKED(IDC_COUNT_HARDLINKS_ONCE, OnSettingChanged)
 END_MESSAGE_MAP()
 
 BOOL CPageAdvanced::OnInitDialog()
@@ -71,6 +75,8 @@ BOOL CPageAdvanced::OnInitDialog()
     m_ExcludeJunctions = COptions::ExcludeJunctions;
     m_ExcludeSymbolicLinks = COptions::ExcludeSymbolicLinks;
     m_SkipDupeDetectionCloudLinks = COptions::SkipDupeDetectionCloudLinks;
+    m_ScanForOwners = COptions::ScanForOwners;
+    m_CountHardLinksOnce = COptions::HardLinkPolicy == HLP_COUNT_FIRST;
     m_SkipHidden = COptions::SkipHidden;
     m_SkipProtected = COptions::SkipProtected;
     m_UseBackupRestore = COptions::UseBackupRestore;
@@ -88,13 +94,17 @@ void CPageAdvanced::OnOK()
         COptions::ExcludeJunctions && COptions::ExcludeJunctions != static_cast<bool>(m_ExcludeJunctions) ||
         COptions::ExcludeSymbolicLinks && COptions::ExcludeSymbolicLinks != static_cast<bool>(m_ExcludeSymbolicLinks) ||
         COptions::ExcludeVolumeMountPoints && COptions::ExcludeVolumeMountPoints != static_cast<bool>(m_ExcludeVolumeMountPoints);
+    const int hardLinkPolicy = m_CountHardLinksOnce ? HLP_COUNT_FIRST : HLP_COUNT_ALL;
     const bool refreshAll = COptions::SkipHidden != static_cast<bool>(m_SkipHidden) ||
-        COptions::SkipProtected != static_cast<bool>(m_SkipProtected);
+        COptions::SkipProtected != static_cast<bool>(m_SkipProtected) ||
+        COptions::HardLinkPolicy != hardLinkPolicy;
 
     COptions::ExcludeJunctions = (FALSE != m_ExcludeJunctions);
     COptions::ExcludeSymbolicLinks = (FALSE != m_ExcludeSymbolicLinks);
     COptions::ExcludeVolumeMountPoints = (FALSE != m_ExcludeVolumeMountPoints);
     COptions::SkipDupeDetectionCloudLinks = (FALSE != m_SkipDupeDetectionCloudLinks);
+    COptions::ScanForOwners = (FALSE != m_ScanForOwners);
+    COptions::HardLinkPolicy = hardLinkPolicy;
     COptions::SkipHidden = (FALSE != m_SkipHidden);
     COptions::SkipProtected = (FALSE != m_SkipProtected);
     COptions::UseBackupRestore = (FALSE != m_UseBackupRestore);
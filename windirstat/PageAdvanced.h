@@ -45,6 +45,8 @@ protected:
     BOOL m_ExcludeJunctions = TRUE;
     BOOL m_ExcludeVolumeMountPoints = TRUE;
     BOOL m_ExcludeSymbolicLinks = TRUE;
+    BOOL m_ScanForOwners = FALSE;
+    BOOL m_CountHardLinksOnce = TRUE;
     BOOL m_SkipDupeDetectionCloudLinks = TRUE;
     BOOL m_SkipHidden = FALSE;
     BOOL m_SkipProtected = FALSE;
@@ -90,6 +90,7 @@ BEGIN_MESSAGE_MAP(CPageTreeMap, CPropertyPage)
     ON_NOTIFY(COLBN_CHANGED, IDC_TREEMAPHIGHLIGHTCOLOR, OnColorChangedTreeMapHighlight)
     ON_BN_CLICKED(IDC_KDIRSTAT, OnSetModified)
     ON_BN_CLICKED(IDC_SEQUOIAVIEW, OnSetModified)
+    ON_BN_CLICKED(IDC_STRIP, OnSetModified)
     ON_BN_CLICKED(IDC_TREEMAPGRID, OnSetModified)
     ON_BN_CLICKED(IDC_RESET, OnBnClickedReset)
     ON_NOTIFY(XYSLIDER_CHANGED, IDC_LIGHTSOURCE, OnLightSourceChanged)
@@ -138,7 +139,7 @@ void CPageTreeMap::UpdateOptions(const bool save)
         m_Options.SetHeightPercent(c_MaxHeight - m_NHeight);
         m_Options.SetScaleFactorPercent(100 - m_NScaleFactor);
         m_Options.SetLightSourcePoint(m_PtLightSource);
-        m_Options.style = m_Style == 0 ? CTreeMap::KDirStatStyle : CTreeMap::SequoiaViewStyle;
+        m_Options.style = static_cast<CTreeMap::STYLE>(m_Style);
         m_Options.grid = FALSE != m_Grid;
         m_Options.gridColor = m_GridColor.GetColor();
     }
@@ -149,7 +150,7 @@ void CPageTreeMap::UpdateOptions(const bool save)
         m_NHeight = c_MaxHeight - m_Options.GetHeightPercent();
         m_NScaleFactor = 100 - m_Options.GetScaleFactorPercent();
         m_PtLightSource = m_Options.GetLightSourcePoint();
-        m_Style = m_Options.style == CTreeMap::KDirStatStyle ? 0 : 1;
+        m_Style = static_cast<int>(m_Options.style);
         m_Grid = m_Options.grid;
         m_GridColor.SetColor(m_Options.gridColor);
     }
@@ -0,0 +1,414 @@
+// TreeMapExport.cpp
+//
+// WinDirStat - Directory Statistics
+// Copyright (C) 2024 WinDirStat Team (windirstat.net)
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#include "stdafx.h"
+#include "CsvLoader.h"
+#include "DirStatDoc.h"
+#include "GlobalHelpers.h"
+#include "Item.h"
+#include "TreeMapExport.h"
+#include "TreeMapSnapshot.h"
+
+#include <wincodec.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+#pragma comment(lib, "windowscodecs.lib")
+
+namespace
+{
+    bool SavePpm(const std::wstring& path, const std::vector<COLORREF>& bitmap, const CSize& size)
+    {
+        std::ofstream writer(path, std::ios::binary);
+        if (!writer.is_open()) return false;
+
+        writer << "P6\n" << size.cx << " " << size.cy << "\n255\n";
+        std::vector<BYTE> rgb;
+        rgb.reserve(bitmap.size() * 3);
+        for (const COLORREF pixel : bitmap)
+        {
+            // The bitmap holds BGR() values, i.e. red in the third byte
+            rgb.push_back(static_cast<BYTE>(pixel >> 16));
+            rgb.push_back(static_cast<BYTE>(pixel >> 8));
+            rgb.push_back(static_cast<BYTE>(pixel));
+        }
+        writer.write(reinterpret_cast<const char*>(rgb.data()), static_cast<std::streamsize>(rgb.size()));
+        return writer.good();
+    }
+
+    bool SavePng(const std::wstring& path, const std::vector<COLORREF>& bitmap, const CSize& size)
+    {
+        CComPtr<IWICImagingFactory> factory;
+        CComPtr<IWICStream> stream;
+        CComPtr<IWICBitmapEncoder> encoder;
+        CComPtr<IWICBitmapFrameEncode> frame;
+        if (FAILED(::CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory))) ||
+            FAILED(factory->CreateStream(&stream)) ||
+            FAILED(stream->InitializeFromFilename(path.c_str(), GENERIC_WRITE)) ||
+            FAILED(factory->CreateEncoder(GUID_ContainerFormatPng, nullptr, &encoder)) ||
+            FAILED(encoder->Initialize(stream, WICBitmapEncoderNoCache)) ||
+            FAILED(encoder->CreateNewFrame(&frame, nullptr)) ||
+            FAILED(frame->Initialize(nullptr)) ||
+            FAILED(frame->SetSize(size.cx, size.cy)))
+        {
+            return false;
+        }
+
+        // The layout of a BGR() value in memory is that of 32bppBGR
+        WICPixelFormatGUID format = GUID_WICPixelFormat32bppBGR;
+        if (FAILED(frame->SetPixelFormat(&format)) || format != GUID_WICPixelFormat32bppBGR)
+        {
+            return false;
+        }
+
+        const UINT stride = size.cx * sizeof(COLORREF);
+        return SUCCEEDED(frame->WritePixels(size.cy, stride, stride * size.cy,
+            reinterpret_cast<BYTE*>(const_cast<COLORREF*>(bitmap.data())))) &&
+            SUCCEEDED(frame->Commit()) && SUCCEEDED(encoder->Commit());
+    }
+
+    // Colors the files by extension the same way CDirStatDoc does:
+    // the palette is assigned in order of decreasing total size
+    CTreeMapSnapshot::ColorFunction GetExtensionColors(const CItem* root)
+    {
+        CExtensionData extensionData;
+        root->CollectExtensionData(&extensionData);
+
+        std::vector<std::pair<std::wstring, ULONGLONG>> sorted;
+        for (const auto& [ext, record] : extensionData)
+        {
+            sorted.emplace_back(ext, record.bytes);
+        }
+        std::ranges::sort(sorted, [](const auto& a, const auto& b) { return a.second > b.second; });
+
+        std::vector<COLORREF> palette;
+        CTreeMap::GetDefaultPalette(palette);
+        auto colors = std::make_shared<std::unordered_map<std::wstring, COLORREF>>();
+        for (std::size_t i = 0; i < sorted.size(); i++)
+        {
+            (*colors)[sorted[i].first] = palette[min(i, palette.size() - 1)];
+        }
+
+        return [colors](const CItem* item)
+        {
+            return item->IsType(IT_FILE) ? colors->at(item->GetExtension()) : item->TmiGetGraphColor();
+        };
+    }
+
+    // A generated tree whose fan-out and file sizes follow Pareto distributions,
+    // as on real disks: most folders hold a few files, a few hold thousands
+    class CSyntheticItem final : public CTreeMap::Item
+    {
+    public:
+        bool TmiIsLeaf() const override { return m_Children.empty(); }
+        CRect TmiGetRectangle() const override { return m_Rect; }
+        void TmiSetRectangle(const CRect& rc) override { m_Rect = rc; }
+        COLORREF TmiGetGraphColor() const override { return m_Color; }
+        int TmiGetChildCount() const override { return static_cast<int>(m_Children.size()); }
+        CTreeMap::Item* TmiGetChild(const int c) const override { return m_Children[c].get(); }
+        ULONGLONG TmiGetSize() const override { return m_Size; }
+
+        // Adds up to fanout children while the budget of items lasts. A tenth
+        // of them are folders with a fan-out of their own, the rest files.
+        void Generate(std::mt19937& random, const std::vector<COLORREF>& palette, const int depth,
+            const std::size_t fanout, std::size_t& budget)
+        {
+            std::uniform_real_distribution<> uniform;
+            const auto pareto = [&](const double minimum, const double alpha)
+            {
+                return minimum / std::pow(1.0 - uniform(random), 1.0 / alpha);
+            };
+
+            for (std::size_t i = 0; i < fanout && budget > 0; i++)
+            {
+                budget--;
+                auto child = std::make_unique<CSyntheticItem>();
+                if (depth < 12 && uniform(random) < 0.1)
+                {
+                    child->Generate(random, palette, depth + 1, static_cast<std::size_t>(min(pareto(1.0, 1.1), 1e6)), budget);
+                }
+                if (child->m_Children.empty())
+                {
+                    child->m_Size = static_cast<ULONGLONG>(min(pareto(512.0, 1.2), 1e12));
+                    child->m_Color = palette[random() % palette.size()];
+                }
+                m_Size += child->m_Size;
+                m_Children.emplace_back(std::move(child));
+            }
+            std::ranges::sort(m_Children, [](const auto& a, const auto& b) { return a->m_Size > b->m_Size; });
+        }
+
+    private:
+        std::vector<std::unique_ptr<CSyntheticItem>> m_Children;
+        CRect m_Rect;
+        ULONGLONG m_Size = 0;
+        COLORREF m_Color = RGB(160, 160, 160);
+    };
+
+    int RenderImage(CTreeMapSnapshot& snapshot, const std::wstring& path, const CSize& size)
+    {
+        CTreeMap treemap;
+        std::vector<COLORREF> bitmap;
+        treemap.RenderTreeMap(bitmap, size, &snapshot, &COptions::TreeMapOptions);
+        if (!SaveTreeMapImage(path, bitmap, size))
+        {
+            WriteCommandOutput(std::format(L"Cannot write {}\n", path));
+            return 1;
+        }
+        return 0;
+    }
+
+    // Average ratio of the longer to the shorter side of the drawn rectangles
+    double AverageAspectRatio(const std::vector<CTreeMap::LAYOUTITEM>& layout)
+    {
+        double sum = 0;
+        int count = 0;
+        for (const auto& entry : layout)
+        {
+            const int width = entry.rc.Width();
+            const int height = entry.rc.Height();
+            if (entry.leaf != nullptr && width > 0 && height > 0)
+            {
+                sum += static_cast<double>(max(width, height)) / min(width, height);
+                count++;
+            }
+        }
+        return count > 0 ? sum / count : 0.0;
+    }
+
+    // Average time of laying out root, which is not rendered, as the colors
+    // of the items require a document
+    double MeasureLayout(CTreeMap& treemap, CItem* root, const CSize& size, const int iterations)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            treemap.LayoutTreeMap(root, size);
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+    }
+
+    // Reports layout and shading times separately: the first rendering of
+    // an iteration lays out the tree again, the second reuses that layout.
+    // The layout of the items is measured with both access policies.
+    int RunBenchmark(CTreeMapSnapshot& snapshot, CItem* root, const CSize& size, const int iterations)
+    {
+        using Clock = std::chrono::steady_clock;
+        const auto milliseconds = [](const Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+        for (const auto& [style, name] : { std::pair(CTreeMap::KDirStatStyle, L"KDirStat"),
+            std::pair(CTreeMap::SequoiaViewStyle, L"SequoiaView"), std::pair(CTreeMap::StripStyle, L"Strip") })
+        {
+            CTreeMap::Options options = COptions::TreeMapOptions;
+            options.style = style;
+
+            CTreeMap treemap;
+            std::vector<COLORREF> bitmap;
+            treemap.RenderTreeMap(bitmap, size, &snapshot, &options);
+
+            Clock::duration full{};
+            Clock::duration shading{};
+            for (int i = 0; i < iterations; i++)
+            {
+                treemap.InvalidateLayout();
+                const auto start = Clock::now();
+                treemap.RenderTreeMap(bitmap, size, &snapshot);
+                const auto middle = Clock::now();
+                treemap.RenderTreeMap(bitmap, size, &snapshot);
+                full += middle - start;
+                shading += Clock::now() - middle;
+            }
+
+            const double layoutTime = milliseconds(full - shading) / iterations;
+            const double shadingTime = milliseconds(shading) / iterations;
+            WriteCommandOutput(std::format(L"{}: {}x{}, {} entries, aspect ratio {:.2f}, layout {:.2f} ms, shading {:.2f} ms, {:.1f} Mpixel/s\n",
+                name, size.cx, size.cy, treemap.GetLayout().size(), AverageAspectRatio(treemap.GetLayout()), layoutTime, shadingTime,
+                size.cx * size.cy / max(shadingTime, 0.001) / 1000.0));
+
+            // The loaded items themselves, through the virtual interface and directly
+            const double virtualTime = MeasureLayout(treemap, root, size, iterations);
+            treemap.SetItemAccess<CItem::TreeMapAccess>();
+            const double directTime = MeasureLayout(treemap, root, size, iterations);
+            WriteCommandOutput(std::format(L"{}: layout of items {:.2f} ms virtual, {:.2f} ms direct ({:.2f}x)\n",
+                name, virtualTime, directTime, virtualTime / max(directTime, 0.001)));
+        }
+
+        return 0;
+    }
+
+    // Renders the treemap at common screen sizes on the calling thread and on
+    // all processors. The layout is made once per size, so only the shading
+    // is measured, and both bitmaps must be the same.
+    int RunScalingBenchmark(CTreeMapSnapshot& snapshot, const int iterations)
+    {
+        using Clock = std::chrono::steady_clock;
+        const auto milliseconds = [](const Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+        for (const auto& [size, name] : { std::pair(CSize(1920, 1080), L"1080p"),
+            std::pair(CSize(3840, 2160), L"4K"), std::pair(CSize(7680, 4320), L"8K") })
+        {
+            CTreeMap treemap;
+            std::vector<COLORREF> bitmaps[2];
+            double times[2] = {};
+            for (const bool parallel : { false, true })
+            {
+                treemap.SetParallelRendering(parallel);
+                treemap.RenderTreeMap(bitmaps[parallel], size, &snapshot, &COptions::TreeMapOptions);
+
+                const auto start = Clock::now();
+                for (int i = 0; i < iterations; i++)
+                {
+                    treemap.RenderTreeMap(bitmaps[parallel], size, &snapshot);
+                }
+                times[parallel] = milliseconds(Clock::now() - start) / iterations;
+            }
+
+            WriteCommandOutput(std::format(L"{}: {} entries, {:.2f} ms on one thread, {:.2f} ms on {} threads ({:.2f}x), {}\n",
+                name, treemap.GetLayout().size(), times[false], times[true], std::thread::hardware_concurrency(),
+                times[false] / max(times[true], 0.001), bitmaps[false] == bitmaps[true] ? L"identical" : L"DIFFERENT"));
+        }
+
+        return 0;
+    }
+
+    // Lays out and renders a synthetic tree with and without culling small subtrees,
+    // and counts the pixels which differ from the rendering without culling
+    int RunCullingBenchmark(const std::size_t items, const CSize& size, const int iterations)
+    {
+        std::vector<COLORREF> palette;
+        CTreeMap::GetDefaultPalette(palette);
+        std::mt19937 random(42);
+        std::size_t budget = items;
+        CSyntheticItem root;
+        root.Generate(random, palette, 0, std::numeric_limits<std::size_t>::max(), budget);
+
+        std::vector<COLORREF> reference;
+        double referenceTime = 0;
+        for (const int minimumArea : { 0, 4, 16, 64 })
+        {
+            CTreeMap::Options options = COptions::TreeMapOptions;
+            options.minimumArea = minimumArea;
+
+            CTreeMap treemap;
+            std::vector<COLORREF> bitmap;
+            treemap.RenderTreeMap(bitmap, size, &root, &options);
+
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++)
+            {
+                treemap.InvalidateLayout();
+                treemap.RenderTreeMap(bitmap, size, &root);
+            }
+            const double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+            if (minimumArea == 0)
+            {
+                reference = bitmap;
+                referenceTime = time;
+            }
+            std::size_t changed = 0;
+            for (std::size_t i = 0; i < bitmap.size(); i++)
+            {
+                if (bitmap[i] != reference[i]) changed++;
+            }
+
+            WriteCommandOutput(std::format(L"Minimum area {}: {} items, {} entries, {:.2f} ms ({:.2f}x), {:.2f}% pixels changed\n",
+                minimumArea, items - budget, treemap.GetLayout().size(), time, referenceTime / max(time, 0.001),
+                100.0 * static_cast<double>(changed) / static_cast<double>(bitmap.size())));
+        }
+
+        return 0;
+    }
+
+    // Shades a single cushion with each kernel, independent of any results
+    int RunCushionBenchmark(const CSize& size, const int iterations)
+    {
+        CTreeMap treemap;
+        const auto timings = treemap.MeasureCushionShading(size, iterations);
+        for (const auto& timing : timings)
+        {
+            WriteCommandOutput(std::format(L"{}: {}x{}, {:.1f} Mpixel/s ({:.2f}x), deviation {}\n", timing.name, size.cx, size.cy,
+                timing.pixelsPerSecond / 1000000.0, timing.pixelsPerSecond / timings.front().pixelsPerSecond, timing.maxDeviation));
+        }
+        return 0;
+    }
+}
+
+bool SaveTreeMapImage(const std::wstring& path, const std::vector<COLORREF>& bitmap, const CSize& size)
+{
+    const bool ppm = path.size() >= 4 && _wcsicmp(path.c_str() + path.size() - 4, L".ppm") == 0;
+    return ppm ? SavePpm(path, bitmap, size) : SavePng(path, bitmap, size);
+}
+
+int RunTreeMapCommand(const std::vector<std::wstring>& args)
+{
+    const bool render = args.size() >= 3 && _wcsicmp(args[1].c_str(), L"/treemap") == 0;
+    const bool benchmark = args.size() >= 3 && _wcsicmp(args[1].c_str(), L"/treemapbench") == 0;
+    if (!render && !benchmark)
+    {
+        return -1;
+    }
+
+    if (benchmark && _wcsicmp(args[2].c_str(), L"/cushion") == 0)
+    {
+        return RunCushionBenchmark(CSize(ParseCommandInt(args, 3, 3840), ParseCommandInt(args, 4, 2160)), ParseCommandInt(args, 5, 20));
+    }
+
+    if (benchmark && _wcsicmp(args[2].c_str(), L"/culling") == 0)
+    {
+        return RunCullingBenchmark(static_cast<std::size_t>(max(ParseCommandInt(args, 3, 1000000), 1)), CSize(ParseCommandInt(args, 4, 1920), ParseCommandInt(args, 5, 1080)),
+            ParseCommandInt(args, 6, 10));
+    }
+
+    const std::unique_ptr<CItem> root(LoadResults(args[2]));
+    if (root == nullptr)
+    {
+        WriteCommandOutput(std::format(L"Cannot load {}\n", args[2]));
+        return 1;
+    }
+
+    CTreeMapSnapshot snapshot(root.get(), std::numeric_limits<int>::max(), GetExtensionColors(root.get()));
+
+    if (benchmark && args.size() >= 4 && _wcsicmp(args[3].c_str(), L"/scaling") == 0)
+    {
+        return RunScalingBenchmark(snapshot, ParseCommandInt(args, 4, 10));
+    }
+
+    if (render)
+    {
+        if (args.size() < 4)
+        {
+            WriteCommandOutput(L"Usage: windirstat.exe /treemap <results.csv> <image.png|image.ppm> [width] [height]\n");
+            return 1;
+        }
+        return RenderImage(snapshot, args[3], CSize(ParseCommandInt(args, 4, 1920), ParseCommandInt(args, 5, 1080)));
+    }
+
+    return RunBenchmark(snapshot, root.get(), CSize(ParseCommandInt(args, 3, 1920), ParseCommandInt(args, 4, 1080)), ParseCommandInt(args, 5, 10));
+}
@@ -0,0 +1,40 @@
+// TreeMapExport.h
+//
+// WinDirStat - Directory Statistics
+// Copyright (C) 2024 WinDirStat Team (windirstat.net)
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Writes a bitmap of CTreeMap::RenderTreeMap() as .ppm or, for any other extension, as .png
+bool SaveTreeMapImage(const std::wstring& path, const std::vector<COLORREF>& bitmap, const CSize& size);
+
+// Handles the command lines
+//   windirstat.exe /treemap <results.csv> <image.png|image.ppm> [width] [height]
+//   windirstat.exe /treemapbench <results.csv> [width] [height] [iterations]
+//   windirstat.exe /treemapbench <results.csv> /scaling [iterations]
+//   windirstat.exe /treemapbench /cushion [width] [height] [iterations]
+//   windirstat.exe /treemapbench /culling [items] [width] [height] [iterations]
+// which render or benchmark the treemap of saved results, measure the parallel
+// rendering of it at 1080p, 4K and 8K, benchmark the cushion shading kernels,
+// or compare the culling of small subtrees on a synthetic heavy-tailed tree,
+// without showing a window.
+// Returns the process exit code or -1 if the command line is not one of these.
+int RunTreeMapCommand(const std::vector<std::wstring>& args);
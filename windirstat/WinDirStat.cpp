@@ -33,6 +33,8 @@
 #include "GlobalHelpers.h"
 #include "Localization.h"
 #include "SmartPointer.h"
+#include "TreeMapExport.h"
+#include "Benchmarks.h"
 
 CIconImageList* GetIconImageList()
 {
@@ -259,6 +261,16 @@ BOOL CDirStatApp::InitInstance()
     COptions::LoadAppSettings();
     CWinAppEx::LoadStdProfileSettings(4);
 
+    // Render or benchmark the treemap of saved results, or run
+    // other benchmarks, without showing a window
+    const std::vector<std::wstring> args(__wargv, __wargv + __argc);
+    m_CommandExitCode = RunTreeMapCommand(args);
+    if (m_CommandExitCode < 0) m_CommandExitCode = RunBenchmarkCommand(args);
+    if (m_CommandExitCode >= 0)
+    {
+        return FALSE;
+    }
+
     m_PDocTemplate = new CSingleDocTemplate(
         IDR_MAINFRAME,
         RUNTIME_CLASS(CDirStatDoc),
@@ -322,6 +334,12 @@ BOOL CDirStatApp::InitInstance()
     return TRUE;
 }
 
+int CDirStatApp::ExitInstance()
+{
+    const int exitCode = CWinAppEx::ExitInstance();
+    return m_CommandExitCode >= 0 ? m_CommandExitCode : exitCode;
+}
+
 void CDirStatApp::OnAppAbout()
 {
     StartAboutDialog();
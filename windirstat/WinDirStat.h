@@ -46,6 +46,7 @@ public:
 
     CDirStatApp();
     BOOL InitInstance() override;
+    int ExitInstance() override;
     BOOL LoadState(LPCTSTR, CFrameImpl*) override { return TRUE; }
 
     bool InPortableMode() const;
@@ -73,6 +74,7 @@ protected:
     COLORREF GetAlternativeColor(COLORREF clrDefault, const std::wstring& which);
 
     CSingleDocTemplate* m_PDocTemplate{nullptr}; // MFC voodoo.
+    int m_CommandExitCode = -1;                  // Exit code of RunTreeMapCommand(), -1 if not run
 
     CReparsePoints m_ReparsePoints;   // Mount point information
     CIconImageList m_MyImageList;     // Our central image list
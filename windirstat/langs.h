@@ -227,6 +227,12 @@
 #define IDS_GENERIC_NO                  20229
 #define IDS_GENERIC_OK                  20230
 #define IDS_GENERIC_CANCEL              20231
+#define IDS_PAGE_TREEMAP_STRIP          20232
+#define IDS_OWNER_RESOLVING             20233
+#define IDS_DUPLICATES_READS_AVOIDEDs   20234
+#define IDS_DUPLICATES_INSERTEDsss      20235
+#define IDS_TREEMAP_PROGRESSIVEsss      20236
+#define IDS_TREEMAP_UPDATEDssss         20237
 
 // Next default values for new objects
 // 
@@ -115,6 +115,9 @@
 #define IDC_BROWSE_FOLDER               1232
 #define IDC_FILENAMES                   1233
 #define IDC_SCAN_DUPLICATES             1234
+#define IDC_STRIP                       1235
+#define IDC_SCAN_OWNERS                 1236
+#define IDC_COUNT_HARDLINKS_ONCE        1237
 #define ID_WDS_CONTROL                  4711
 #define ID_CLEANUP_EXPLORER_SELECT      32774
 #define ID_TREEMAP_ZOOMIN               32783
@@ -168,7 +171,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        954
 #define _APS_NEXT_COMMAND_VALUE         33039
-#define _APS_NEXT_CONTROL_VALUE         1235
+#define _APS_NEXT_CONTROL_VALUE         1238
 #define _APS_NEXT_SYMED_VALUE           109
 #endif
 #endif